@@ -0,0 +1,84 @@
+/*********************************************************************/
+/* Project: uw-img-proc									             */
+/* Module:  benchmark						  		                 */
+/* File: 	benchmark.h							         	         */
+/* Created:	18/10/2026				                                 */
+/* Description:
+	C++ Module that compares the enhancement methods of the project
+	with the image quality metrics in a single process				 */
+/********************************************************************/
+
+///Basic C and C++ libraries
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+/// OpenCV libraries. May need review for the final release
+#include <opencv2/core.hpp>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+
+// C++ namespaces
+using namespace cv;
+using namespace std;
+
+/*
+	@brief		Mean runtime and quality of one enhancement method over the images of a benchmark
+*/
+struct matrixRow {
+	std::string method;					// Name of the enhancement method
+	int images = 0;						// Images enhanced by the method
+	double time = 0;					// Mean runtime of the method in ms
+	std::vector<double> values;			// Mean of each metric, in the order of the columns
+};
+
+/*
+	@brief		Selects the enhancement methods from a list separated by ',' (ALL for every method). Unknown names
+				are reported and left out
+	@function	std::vector<std::string> enhancementMethods(std::string list)
+*/
+std::vector<std::string> enhancementMethods(std::string list);
+
+/*
+	@brief		Applies one enhancement method to an image with the CPU pipeline of its module.
+				Returns an empty image for an unknown method
+	@function	cv::Mat enhanceImage(cv::Mat src, const std::string &method)
+*/
+cv::Mat enhanceImage(cv::Mat src, const std::string &method);
+
+/*
+	@brief		Images of a directory or of a manifest file (one image per line)
+	@function	std::vector<std::string> listImages(std::string input)
+*/
+std::vector<std::string> listImages(std::string input);
+
+/*
+	@brief		Plans the metrics of the benchmark (letters of the evaluationmetrics module, the reference is the
+				input image) and gives the name and precision of each column. The histograms have no column
+	@function	std::string benchmarkMetrics(std::string metric, std::vector<std::string> &keys, std::vector<int> &precisions)
+*/
+std::string benchmarkMetrics(std::string metric, std::vector<std::string> &keys, std::vector<int> &precisions);
+
+/*
+	@brief		Scores an enhanced image against its input with the single pass engine of the evaluationmetrics module
+	@function	std::vector<double> scoreImage(cv::Mat dst, cv::Mat src, const std::string &metrics)
+*/
+std::vector<double> scoreImage(cv::Mat dst, cv::Mat src, const std::string &metrics);
+
+/*
+	@brief		Runs every method on every image with a pool of workers, one image per worker at a time. Each image is
+				decoded once and every result is scored in memory. The runtime and the metrics of each image and method
+				are written to rows ('image;method;time;metrics...') and their means to the matrix. Returns the number of
+				images evaluated, failed counts the images that could not be loaded and the methods that could not be
+				applied or scored, which are left out of the rows and the matrix
+	@function	int benchmarkImages(const std::vector<std::string> &images, const std::vector<std::string> &methods, const std::string &metrics,
+				int workers, std::ostream &rows, std::vector<matrixRow> &matrix, int *failed)
+*/
+int benchmarkImages(const std::vector<std::string> &images, const std::vector<std::string> &methods, const std::string &metrics,
+	int workers, std::ostream &rows, std::vector<matrixRow> &matrix, int *failed);
@@ -0,0 +1,175 @@
+/*********************************************************************/
+/* Project: uw-img-proc									             */
+/* Module:  benchmark						  		                 */
+/* File: 	benchmark.cpp						         	         */
+/* Created:	18/10/2026				                                 */
+/* Description:
+	C++ Module that compares the enhancement methods of the project
+	with the image quality metrics in a single process				 */
+/********************************************************************/
+
+/// Include auxiliary utility libraries
+#include "../include/benchmark.h"
+
+/// Functions of the modules, linked from their libraries. Each module has its own namespace since they share
+/// function names (getHistogram, histStretch...)
+#include "../../colorcorrection/include/colorcorrection.h"
+#include "../../contrastenhancement/include/contrastenhancement.h"
+#include "../../dehazing/include/dehazing.h"
+#include "../../illumination/include/illumination.h"
+#include "../../fusion/include/fusion.h"
+#include "../../evaluationmetrics/include/evaluationmetrics.h"
+
+static const char *methodNames[] = { "Original", "GWA-Lab", "GWA-CIELAB", "GWA-RGB", "SCB", "ICM", "UCM", "EQ", "Rayleigh",
+	"Dehazing", "Illumination", "Fusion" };
+static const int numMethods = sizeof(methodNames) / sizeof(methodNames[0]);
+
+std::vector<std::string> enhancementMethods(std::string list) {
+	std::vector<std::string> methods;
+	std::stringstream names(list);
+	std::string name;
+	while (std::getline(names, name, ',')) {
+		if (name == "ALL") {
+			for (int i = 0; i < numMethods; i++) methods.push_back(methodNames[i]);
+			continue;
+		}
+		bool known = false;
+		for (int i = 0; i < numMethods; i++) known |= name == methodNames[i];
+		if (known) methods.push_back(name);
+		else if (!name.empty()) std::cout << "Method " << name << " not recognized, skipping..." << endl;
+	}
+	return methods;
+}
+
+cv::Mat enhanceImage(cv::Mat src, const std::string &method) {
+	cv::Mat dst;
+	if (method == "Original") dst = src;
+	else if (method == "GWA-Lab") dst = colorcorrection::GWA_Lab(src);
+	else if (method == "GWA-CIELAB") dst = colorcorrection::GWA_CIELAB(src);
+	else if (method == "GWA-RGB") dst = colorcorrection::GWA_RGB(src);
+	else if (method == "SCB") dst = contrastenhancement::simplestColorBalance(src, 0.5);
+	else if (method == "ICM") dst = contrastenhancement::ICM(src, 0.5);
+	else if (method == "UCM") dst = contrastenhancement::UCM(src, 0.2);
+	else if (method == "EQ") dst = contrastenhancement::equalizeImage(src, false);
+	else if (method == "Rayleigh") dst = contrastenhancement::equalizeImage(src, true);
+	else if (method == "Dehazing") dst = dehazing::dehazeImage(src);
+	else if (method == "Illumination") dst = illumination::correctIllumination(src);
+	else if (method == "Fusion") dst = fusion::fusionEnhance(src, fusion::classifyInput(src, THUMBNAIL_SIZE));
+	if (!dst.empty() && dst.depth() != CV_8U) dst.convertTo(dst, CV_8U);	// As the modules save them with imwrite
+	return dst;
+}
+
+std::vector<std::string> listImages(std::string input) {
+	std::vector<std::string> images;
+	std::string ext = input.substr(input.find_last_of('.') + 1);
+	if (input.find_last_of('.') != std::string::npos && (ext == "txt" || ext == "csv")) {	// Manifest file
+		ifstream manifest(input);
+		std::string line;
+		while (std::getline(manifest, line)) {
+			if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+			line = line.substr(0, line.find_first_of(";,"));
+			if (!line.empty()) images.push_back(line);
+		}
+		return images;
+	}
+	if (evaluationmetrics::isImage(input)) {											// Single image
+		images.push_back(input);
+		return images;
+	}
+	std::vector<cv::String> files;														// Directory
+	cv::glob(input, files, false);
+	for (size_t i = 0; i < files.size(); i++) if (evaluationmetrics::isImage(files[i])) images.push_back(files[i]);
+	return images;
+}
+
+std::string benchmarkMetrics(std::string metric, std::vector<std::string> &keys, std::vector<int> &precisions) {
+	std::string plan = evaluationmetrics::planMetrics(metric, true), metrics;
+	evaluationmetrics::qualityMetrics names;											// Empty result
+	keys.clear(), precisions.clear();
+	for (size_t i = 0; i < plan.size(); i++) {
+		const char *key;
+		double value;
+		int precision;
+		if (!evaluationmetrics::metricValue(names, plan[i], &key, &value, &precision)) continue;
+		metrics += plan[i];
+		keys.push_back(key);
+		precisions.push_back(precision);
+	}
+	return metrics;
+}
+
+std::vector<double> scoreImage(cv::Mat dst, cv::Mat src, const std::string &metrics) {
+	evaluationmetrics::qualityMetrics r = evaluationmetrics::evaluateMetrics(dst, src, metrics);
+	std::vector<double> values;
+	for (size_t i = 0; i < metrics.size(); i++) {
+		const char *key;
+		double value;
+		int precision;
+		if (evaluationmetrics::metricValue(r, metrics[i], &key, &value, &precision)) values.push_back(value);
+	}
+	return values;
+}
+
+int benchmarkImages(const std::vector<std::string> &images, const std::vector<std::string> &methods, const std::string &metrics,
+	int workers, std::ostream &rows, std::vector<matrixRow> &matrix, int *failed) {
+	std::atomic<int> next(0), evaluated(0), fail(0);
+	std::mutex lock;
+	matrix.assign(methods.size(), matrixRow());
+	for (size_t m = 0; m < methods.size(); m++) matrix[m].method = methods[m], matrix[m].values.assign(metrics.size(), 0);
+
+	auto work = [&]() {
+		for (int k = next++; k < (int)images.size(); k = next++) {
+			cv::Mat src = imread(images[k], cv::IMREAD_COLOR);			// Decoded once for every method
+			if (src.empty()) {
+				fail++;
+				std::cerr << "Error occured when loading " + images[k] + "\n";
+				continue;
+			}
+			std::vector<double> times(methods.size(), -1);
+			std::vector<std::vector<double>> values(methods.size());
+			for (size_t m = 0; m < methods.size(); m++) {
+				cv::Mat input = src.clone(), dst;						// The methods may modify their input
+				double t = (double)getTickCount();
+				try {
+					dst = enhanceImage(input, methods[m]);
+					double ms = 1000 * ((double)getTickCount() - t) / getTickFrequency();
+					values[m] = scoreImage(dst, src, metrics);				// A result of another size is not scored
+					times[m] = ms;
+				}
+				catch (const cv::Exception &e) {
+					fail++;
+					std::cerr << "Error occured when applying " + methods[m] + " to " + images[k] + ": " + e.what() + "\n";
+				}
+			}
+
+			// Rows of the image and running sums of the matrix
+			std::string name = images[k].substr(images[k].find_last_of("/\\") + 1);
+			std::ostringstream row;
+			row << fixed;
+			std::lock_guard<std::mutex> guard(lock);
+			for (size_t m = 0; m < methods.size(); m++) {
+				if (times[m] < 0) continue;
+				row << endl << name << ";" << methods[m] << ";" << setprecision(3) << times[m] << ";";
+				for (size_t i = 0; i < values[m].size(); i++) {
+					row << setprecision(5) << values[m][i] << ";";
+					matrix[m].values[i] += values[m][i];
+				}
+				matrix[m].images++;
+				matrix[m].time += times[m];
+			}
+			rows << row.str();
+			evaluated++;
+		}
+	};
+	std::vector<std::thread> pool;
+	for (int i = 0; i < std::max(1, workers); i++) pool.push_back(std::thread(work));
+	for (size_t i = 0; i < pool.size(); i++) pool[i].join();
+
+	for (size_t m = 0; m < matrix.size(); m++) {
+		if (matrix[m].images == 0) continue;
+		matrix[m].time /= matrix[m].images;
+		for (size_t i = 0; i < matrix[m].values.size(); i++) matrix[m].values[i] /= matrix[m].images;
+	}
+	if (failed) *failed = fail;
+	return evaluated;
+}
@@ -0,0 +1,127 @@
+/*********************************************************************/
+/* Project: uw-img-proc									             */
+/* Module:  benchmark						  		                 */
+/* File: 	main.cpp							         	         */
+/* Created:	18/10/2026				                                 */
+/* Description:
+	C++ Module that compares the enhancement methods of the project
+	with the image quality metrics in a single process				 */
+/********************************************************************/
+
+#define ABOUT_STRING "Enhancement Benchmark Module"
+
+/// Include auxiliary utility libraries
+#include "../include/benchmark.h"
+
+// Time measurements
+double t;	// Timing monitor
+
+/*!
+	@fn		int main(int argc, char* argv[])
+	@brief	Main function
+*/
+int main(int argc, char *argv[]) {
+
+	//*********************************************************************************
+	/*	PARSER section */
+	/*  Uses built-in OpenCV parsing method cv::CommandLineParser. It requires a string containing the arguments to be parsed from
+		the command line. Further details can be obtained from opencv webpage
+	*/
+	String keys =
+		"{@input  |<none> | Input image, directory of images or manifest file}"	// Input images are the first argument (positional)
+		"{@output |<none> | Output directory}"									// Output directory is the second argument (positional)
+		"{methods |ALL    | Enhancement methods separated by ','}"				// Enhancement methods (optional)
+		"{m       |EQIPY  | Image Quality Metrics to calculate}"				// Metrics to calculate (optional)
+		"{workers |0      | Images processed in parallel (all cores: 0)}"		// Parallel images (optional)
+		"{help h usage ?  |       | Print help message}";						// Show help (optional)
+
+	CommandLineParser cvParser(argc, argv, keys);
+	cvParser.about(ABOUT_STRING);	// Adds "about" information to the parser method
+
+	//**************************************************************************
+	std::cout << ABOUT_STRING << endl;
+	std::cout << endl << "Built with OpenCV " << CV_VERSION << endl;
+
+	// If the number of arguments is lower than 2, or contains "help" keyword, then we show the help
+	if (argc < 3 || cvParser.has("help")) {
+		std::cout << endl << "C++ Module for the comparison of the enhancement methods" << endl;
+		std::cout << endl << "Arguments are:" << endl;
+		std::cout << "\t*Input: Input image, directory of images or manifest file (.txt or .csv, one image per line)" << endl;
+		std::cout << "\t*Output: Directory of 'benchmark_matrix.csv' and 'benchmark_images.csv'" << endl;
+		std::cout << "\t*-methods=<list> Enhancement methods separated by ',' (default: ALL)" << endl;
+		std::cout << "\t*-m=<metrics> Metrics of the evaluationmetrics module, the reference of M, P and Y is the input image (default: EQIPY)" << endl;
+		std::cout << "\t*-workers=<n> Images processed in parallel (default: all cores)" << endl;
+		std::cout << endl << "Complete options of enhancement methods are:" << endl;
+		std::cout << "\tOriginal for the input image without enhancement" << endl;
+		std::cout << "\tGWA-Lab, GWA-CIELAB and GWA-RGB for the colorcorrection module (L, C and R)" << endl;
+		std::cout << "\tSCB, ICM, UCM, EQ and Rayleigh for the contrastenhancement module (S, I, U, E and R)" << endl;
+		std::cout << "\tDehazing, Illumination and Fusion for their modules" << endl;
+		std::cout << endl << "Example:" << endl;
+		std::cout << "\tdive/ results/ -methods=Original,ICM,UCM,Fusion -m=EQIY -workers=4" << endl;
+		std::cout << "\tThis will enhance every image in 'dive' with ICM, UCM and Fusion and save the runtime and the metrics of each method in 'results'" << endl << endl;
+		return 0;
+	}
+
+	int Workers = 0;										// Default option (one worker per core)
+
+	std::string InputFile = cvParser.get<cv::String>(0);	// String containing the input path from cvParser function
+	std::string OutputDir = cvParser.get<cv::String>(1);	// String containing the output directory from cvParser function
+	std::string Methods = cvParser.get<cv::String>("methods");	// Gets argument -methods=x, where 'x' is the list of enhancement methods
+	std::string metric = cvParser.get<cv::String>("m");		// Gets argument -m=x, where 'x' is the list of quality metrics
+	Workers = cvParser.get<int>("workers");					// Gets argument -workers=x, where 'x' is the number of parallel images
+
+	// Check if any error occurred during parsing process
+	if (!cvParser.check()) {
+		cvParser.printErrors();
+		return -1;
+	}
+
+	std::vector<std::string> images = listImages(InputFile);
+	std::vector<std::string> methods = enhancementMethods(Methods);
+	std::vector<std::string> columns;
+	std::vector<int> precisions;
+	std::string metrics = benchmarkMetrics(metric, columns, precisions);
+
+	if (images.empty() || methods.empty()) {
+		std::cout << "Error: no images or no enhancement methods to compare" << endl << endl;
+		return -1;
+	}
+
+	std::cout << endl << "********************************************************************************" << endl;
+	std::cout << "Input: " << InputFile << " (" << images.size() << " images)" << endl;
+	std::cout << "Methods: " << methods.size() << ", metrics: " << metrics << endl;
+
+	// Results of every image and method, written by the workers as they finish each image
+	ofstream rows(OutputDir + "/benchmark_images.csv");
+	if (!rows.is_open()) {
+		std::cout << "Error occured when opening " << OutputDir << "/benchmark_images.csv" << endl << endl;
+		return -1;
+	}
+	rows << "image;method;time_ms;";
+	for (size_t i = 0; i < columns.size(); i++) rows << columns[i] << ";";
+
+	std::vector<matrixRow> matrix;
+	int failed = 0;
+	t = (double)getTickCount();
+	int evaluated = benchmarkImages(images, methods, metrics, Workers > 0 ? Workers : getNumberOfCPUs(), rows, matrix, &failed);
+	t = 1000 * ((double)getTickCount() - t) / getTickFrequency();
+	std::cout << endl << "Images: " << evaluated << ", failures: " << failed << endl;
+	std::cout << "Execution Time: " << t << " ms (" << (evaluated > 0 ? t / evaluated : 0) << " ms per image)" << endl << endl;
+
+	// Matrix of the mean runtime and quality of each method
+	ofstream file(OutputDir + "/benchmark_matrix.csv");
+	std::ostringstream header;
+	header << "method;images;time_ms;";
+	for (size_t i = 0; i < columns.size(); i++) header << columns[i] << ";";
+	file << header.str();
+	std::cout << header.str() << endl;
+	for (size_t m = 0; m < matrix.size(); m++) {
+		std::ostringstream row;
+		row << matrix[m].method << ";" << matrix[m].images << ";" << fixed << setprecision(3) << matrix[m].time << ";";
+		for (size_t i = 0; i < matrix[m].values.size(); i++) row << setprecision(precisions[i] + 1) << matrix[m].values[i] << ";";
+		file << endl << row.str();
+		std::cout << row.str() << endl;
+	}
+	std::cout << endl << "Benchmark matrix saved in " << OutputDir << "/benchmark_matrix.csv" << endl;
+	return 0;
+}
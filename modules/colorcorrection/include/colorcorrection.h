@@ -37,6 +37,9 @@ using namespace std;
 #include "opencv2/cudaarithm.hpp"
 #endif
 
+// Functions of the module, built as colorcorrection_lib and also linked by the benchmark module
+namespace colorcorrection {
+
 /*
 	@brief		Computes Ruderman's Lab color space components
 	@function	std::vector<Mat_<float>> BGRtoLab(cv::Mat src)
@@ -85,4 +88,6 @@ cv::Mat GWA_RGB(cv::Mat src);
 	cv::cuda::GpuMat GWA_CIELAB_GPU(cv::cuda::GpuMat srcGPU);
 
 	cv::cuda::GpuMat GWA_RGB_GPU(cv::cuda::GpuMat srcGPU);
-#endif
\ No newline at end of file
+#endif
+
+}	// namespace colorcorrection
\ No newline at end of file
@@ -16,6 +16,8 @@
 /// Include auxiliary utility libraries
 #include "../include/colorcorrection.h"
 
+namespace colorcorrection {
+
 std::vector<Mat_<float>> BGRtoLab(cv::Mat src) {
 	src.convertTo(src, CV_32F);
 	std::vector<Mat_<float>> channels;
@@ -230,4 +232,6 @@ cv::Mat GWA_RGB(cv::Mat src) {
 		cv::cuda::merge(channel, 3, dstGPU);
 		return dstGPU;
 }
-#endif
\ No newline at end of file
+#endif
+
+}	// namespace colorcorrection
\ No newline at end of file
@@ -17,6 +17,7 @@
 
 /// Include auxiliary utility libraries
 #include "../include/colorcorrection.h"
+using namespace colorcorrection;
 
 // Time measurements
 #define _VERBOSE_ON_
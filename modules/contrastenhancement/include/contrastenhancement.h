@@ -37,6 +37,9 @@ using namespace std;
 #include "opencv2/cudaarithm.hpp"
 #endif
 
+// Functions of the module, built as contrastenhancement_lib and also linked by the benchmark module
+namespace contrastenhancement {
+
 /*
 	@brief		Enhances an image with the Simplest Color Balance method
 	@function	cv::Mat simplestColorBalance(cv::Mat src, float percent)
@@ -67,6 +70,12 @@ cv::Mat UCM(cv::Mat src, float percent);
 */
 cv::Mat rayleighEqualization(cv::Mat src);
 
+/*
+	@brief		Equalizes each channel of a color image, with Rayleigh's distribution or with the normal equalization
+	@function	cv::Mat equalizeImage(cv::Mat src, bool rayleigh)
+*/
+cv::Mat equalizeImage(cv::Mat src, bool rayleigh);
+
 
 /*
 	@brief		Computes the histogram of a single channel
@@ -89,4 +98,6 @@ void getHistogram(cv::Mat *channel, cv::Mat *hist);
 
 //	void getHistogram_GPU(cv::cuda::GpuMat *channel, cv::Mat *hist);
 
-#endif
\ No newline at end of file
+#endif
+
+}	// namespace contrastenhancement
\ No newline at end of file
@@ -16,6 +16,8 @@
 /// Include auxiliary utility libraries
 #include "../include/contrastenhancement.h"
 
+namespace contrastenhancement {
+
 cv::Mat simplestColorBalance(cv::Mat src, float percent) {			// Simplest Color Balance
 	vector<Mat_<uchar>> channel;
 	split(src, channel);
@@ -134,6 +136,18 @@ cv::Mat rayleighEqualization(cv::Mat src) {
 	return dst;
 }
 
+cv::Mat equalizeImage(cv::Mat src, bool rayleigh) {
+	vector<Mat_<uchar>> channels;
+	cv::Mat dst;
+	split(src, channels);
+	for (int i = 0; i < 3; i++) {
+		if (rayleigh) channels[i] = rayleighEqualization(channels[i]);					// Rayleigh Equalization
+		else cv::equalizeHist(channels[i], channels[i]);								// Normal Equalization
+	}
+	merge(channels, dst);
+	return dst;
+}
+
 #if USE_GPU
 /*
 cv::Mat simplestColorBalance(cv::Mat src, float percent) {			// Simplest Color Balance
@@ -284,4 +298,6 @@ cv::cuda::GpuMat rayleighEqualization_GPU(cv::cuda::GpuMat srcGPU) {
 	dstGPU.upload(dst);
 	return dstGPU;
 }
-#endif
\ No newline at end of file
+#endif
+
+}	// namespace contrastenhancement
\ No newline at end of file
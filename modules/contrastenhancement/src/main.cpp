@@ -17,6 +17,7 @@
 
 /// Include auxiliary utility libraries
 #include "../include/contrastenhancement.h"
+using namespace contrastenhancement;
 
 // Time measurements
 #define _VERBOSE_ON_
@@ -179,7 +180,6 @@ int main(int argc, char *argv[]) {
 	if (! CUDA) {
 
 		cv::Mat balanced;
-		vector<Mat_<uchar>> channels;
 
 		switch (method[0]) {
 
@@ -200,16 +200,12 @@ int main(int argc, char *argv[]) {
 
 			case 'E':	// Normal Equalization
 				std::cout << endl << "Applying contrast enhancement using Normal Equalization" << endl;
-				split(src, channels);
-				for (int i = 0; i < 3; i++) cv::equalizeHist(channels[i], channels[i]);
-				merge(channels, dst);
+				dst = equalizeImage(src, false);
 			break;
 
 			case 'R':	// Rayleigh Equalization
 				std::cout << endl << "Applying contrast enhancement using Rayleigh Equalization" << endl;
-				split(src, channels);
-				for (int i = 0; i < 3; i++) channels[i] = rayleighEqualization(channels[i]);
-				merge(channels, dst);
+				dst = equalizeImage(src, true);
 			break;
 
 			default:	// Unrecognized Option
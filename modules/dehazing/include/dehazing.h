@@ -36,6 +36,9 @@ using namespace ximgproc;
 #include "opencv2/cudaimgproc.hpp"
 #endif
 
+// Functions of the module, built as dehazing_lib and also linked by the benchmark module
+namespace dehazing {
+
 /*
 	@brief		Generates the Bright Channel Image of an underwater image
 	@function	cv::Mat brightChannel(vector<Mat_<uchar>> channels, int size)
@@ -74,6 +77,12 @@ cv::Mat transmittance(cv::Mat correct, vector<uchar> A);
 */
 cv::Mat dehaze(vector<Mat_<float>> channels, vector<uchar> A, cv::Mat trans);
 
+/*
+	@brief		Dehazes an underwater image with the whole CPU pipeline of the module
+	@function	cv::Mat dehazeImage(cv::Mat src)
+*/
+cv::Mat dehazeImage(cv::Mat src);
+
 #if USE_GPU
 cv::cuda::GpuMat brightChannel_GPU(std::vector<cv::cuda::GpuMat> channels, int size);
 
@@ -86,4 +95,6 @@ std::vector<uchar> lightEstimation_GPU(cv::Mat src_gray, int size, cv::cuda::Gpu
 cv::cuda::GpuMat transmittance_GPU(cv::cuda::GpuMat correct, std::vector<uchar> A);
 
 cv::cuda::GpuMat dehaze_GPU(std::vector<cv::cuda::GpuMat> channels, std::vector<uchar> A, cv::cuda::GpuMat trans);
-#endif
\ No newline at end of file
+#endif
+
+}	// namespace dehazing
\ No newline at end of file
@@ -15,6 +15,8 @@
 /// Include auxiliary utility libraries
 #include "../include/dehazing.h"
 
+namespace dehazing {
+
 cv::Mat brightChannel(std::vector<cv::Mat_<uchar>> channels, int size) {					// Generates the Bright Channel Image
 	cv::Mat maxRGB = max(max(channels[0], channels[1]), channels[2]);						// Maximum Color Image
 	cv::Mat element, bright_chan;
@@ -105,6 +107,50 @@ cv::Mat dehaze(vector<Mat_<float>> channels, std::vector<uchar> A, cv::Mat trans
 	return dst;
 }
 
+cv::Mat dehazeImage(cv::Mat src) {										// Dehazes the Underwater Image (CPU pipeline)
+	// Split the RGB channels (BGR for OpenCV)
+	std::vector<cv::Mat_<uchar>> src_chan, new_chan;
+	split(src, src_chan);
+
+	// Compute the new channels for the dehazing process
+	new_chan.push_back(255 - src_chan[0]);
+	new_chan.push_back(255 - src_chan[1]);
+	new_chan.push_back(src_chan[2]);
+
+	// Compute the bright channel image
+	int size = sqrt(src.total()) / 50;						// Making the size bigger creates halos around objects
+	cv::Mat bright_chan = brightChannel(new_chan, size);
+
+	// Compute the maximum color difference
+	cv::Mat mcd = maxColDiff(src_chan);
+
+	// Rectify the bright channel image
+	cv::Mat src_HSV, S;
+	cv::cvtColor(src, src_HSV, COLOR_BGR2HSV);
+	extractChannel(src_HSV, S, 1);
+	cv::Mat rectified = rectify(S, bright_chan, mcd);
+
+	// Estimate the atmospheric light
+	cv::Mat src_gray;
+	cv::cvtColor(src, src_gray, COLOR_BGR2GRAY);
+	std::vector<uchar> A;
+	A = lightEstimation(src_gray, size, bright_chan, new_chan);
+
+	// Compute the transmittance image
+	cv::Mat trans = transmittance(rectified, A);
+
+	// Refine the transmittance image
+	cv::Mat filtered;
+	guidedFilter(src_gray, trans, filtered, 30, 0.001, -1);
+
+	// Dehaze the image channels
+	std::vector<cv::Mat_<float>> chan_dehazed;
+	chan_dehazed.push_back(new_chan[0]);
+	chan_dehazed.push_back(new_chan[1]);
+	chan_dehazed.push_back(new_chan[2]);
+	return dehaze(chan_dehazed, A, filtered);
+}
+
 #if USE_GPU
 cv::cuda::GpuMat brightChannel_GPU(std::vector<cv::cuda::GpuMat> channels, int size) {				// Generates the Bright Channel Image
 	cv::cuda::GpuMat maxRGB = cv::cuda::max(cv::cuda::max(channels[0], channels[1]), channels[2]);	// Maximum Color Image
@@ -198,4 +244,6 @@ cv::cuda::GpuMat dehaze_GPU(std::vector<cv::cuda::GpuMat> channels, std::vector<
 	dehazed.convertTo(dst, CV_8U);
 	return dst;
 }
-#endif
\ No newline at end of file
+#endif
+
+}	// namespace dehazing
\ No newline at end of file
@@ -16,6 +16,7 @@
 
 /// Include auxiliary utility libraries
 #include "../include/dehazing.h"
+using namespace dehazing;
 
 // Time measurements
 #define _VERBOSE_ON_
@@ -180,49 +181,7 @@ int main(int argc, char *argv[]) {
 #endif
 
 // CPU Implementation
-if (!CUDA) {
-	// Split the RGB channels (BGR for OpenCV)
-	std::vector<cv::Mat_<uchar>> src_chan, new_chan;
-	split(src, src_chan);
-
-	// Compute the new channels for the dehazing process
-	new_chan.push_back(255 - src_chan[0]);
-	new_chan.push_back(255 - src_chan[1]);
-	new_chan.push_back(src_chan[2]);
-
-	// Compute the bright channel image
-	int size = sqrt(src.total()) / 50;						// Making the size bigger creates halos around objects
-	cv::Mat bright_chan = brightChannel(new_chan, size);
-
-	// Compute the maximum color difference
-	cv::Mat mcd = maxColDiff(src_chan);
-
-	// Rectify the bright channel image
-	cv::Mat src_HSV, S;
-	cv::cvtColor(src, src_HSV, COLOR_BGR2HSV);
-	extractChannel(src_HSV, S, 1);
-	cv::Mat rectified = rectify(S, bright_chan, mcd);
-
-	// Estimate the atmospheric light
-	cv::Mat src_gray;
-	cv::cvtColor(src, src_gray, COLOR_BGR2GRAY);
-	std::vector<uchar> A;
-	A = lightEstimation(src_gray, size, bright_chan, new_chan);
-
-	// Compute the transmittance image
-	cv::Mat trans = transmittance(rectified, A);
-
-	// Refine the transmittance image
-	cv::Mat filtered;
-	guidedFilter(src_gray, trans, filtered, 30, 0.001, -1);
-
-	// Dehaze the image channels
-	std::vector<cv::Mat_<float>> chan_dehazed;
-	chan_dehazed.push_back(new_chan[0]);
-	chan_dehazed.push_back(new_chan[1]);
-	chan_dehazed.push_back(new_chan[2]);
-	dst = dehaze(chan_dehazed, A, filtered);
-}
+if (!CUDA) dst = dehazeImage(src);
 
 //  End time measurement (Showing time results is optional)
 if (Time) {
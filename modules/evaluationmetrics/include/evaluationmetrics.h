@@ -18,19 +18,37 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <map>
+#include <deque>
+#include <condition_variable>
+#include <algorithm>
 
 /// OpenCV libraries. May need review for the final release
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
+#include <opencv2/videoio.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/features2d.hpp>
-#include <opencv2/xfeatures2d.hpp>
+#include <opencv2/opencv_modules.hpp>
+#ifdef HAVE_OPENCV_XFEATURES2D
+#include <opencv2/xfeatures2d.hpp>                  // SURF is only available with the contrib modules
+#endif
 
 // C++ namespaces
 using namespace cv;
 using namespace cuda;
 using namespace std;
+#ifdef HAVE_OPENCV_XFEATURES2D
 using namespace xfeatures2d;
+#endif
 
 /// CUDA specific libraries
 #if USE_GPU
@@ -41,6 +59,9 @@ using namespace xfeatures2d;
 #include "opencv2/cudaarithm.hpp"
 #endif
 
+// Functions of the module, built as evaluationmetrics_lib and also linked by the benchmark module
+namespace evaluationmetrics {
+
 /*
     @brief      Computes the entropy of a grayscale image according to the Shannon Index
     @function   float entropy(cv::Mat img)
@@ -83,6 +104,20 @@ float getCAF(float AE, float AC, float NNF);
 */
 float getMSE(cv::Mat src, cv::Mat dst);
 
+/*
+    @brief      Full reference metrics of the B, G, R channels and of the grayscale image (index 3)
+*/
+struct fullReference {
+    double MSE[4], PSNR[4], SSIM[4];
+};
+
+/*
+    @brief      Computes the MSE, PSNR and SSIM (11x11 Gaussian window) of two BGR images in a single read of both images.
+                The grayscale values are computed on the fly and the row bands are processed in parallel
+    @function   fullReference compareImages(cv::Mat src, cv::Mat ref, bool ssim)
+*/
+fullReference compareImages(cv::Mat src, cv::Mat ref, bool ssim);
+
 /*
     @brief      Computes the peak signal to noise ratio
     @function   float getPSNR(double mse)
@@ -95,6 +130,50 @@ float getPSNR(float mse);
 */
 float sharpness(cv::Mat src);
 
+/*
+    @brief      Computes the Frequency Domain Image Sharpness of each tile x tile tile of the image in parallel and returns the
+                mean of the tiles. The tiles of the right and bottom borders are aligned with the border so every spectrum
+                has the same size. The map gets the sharpness of every tile if it is not NULL
+    @function   float sharpnessTiled(cv::Mat src, int tile, cv::Mat *map)
+*/
+float sharpnessTiled(cv::Mat src, int tile, cv::Mat *map);
+
+/*
+    @brief      Creates an image of the size of the original with the sharpness of each tile scaled to 0-255
+    @function   cv::Mat sharpnessImage(cv::Mat map, cv::Size size)
+*/
+cv::Mat sharpnessImage(cv::Mat map, cv::Size size);
+
+/*
+    @brief      Computes the Underwater Color Image Quality Evaluation (UCIQE) of an 8 bit CIELab image
+    @function   float getUCIQE(cv::Mat lab)
+*/
+float getUCIQE(cv::Mat lab);
+
+/*
+    @brief      Computes the Underwater Image Colorfulness Measure from the alpha trimmed statistics of the RG and YB components
+    @function   float getUICM(std::vector<Mat> chanRGB)
+*/
+float getUICM(std::vector<Mat> chanRGB);
+
+/*
+    @brief      Computes the Underwater Image Sharpness Measure, the weighted EME of the Sobel edges of each channel
+    @function   float getUISM(std::vector<Mat> chanRGB)
+*/
+float getUISM(std::vector<Mat> chanRGB);
+
+/*
+    @brief      Computes the Underwater Image Contrast Measure, the logAMEE of the intensity
+    @function   float getUIConM(cv::Mat gray)
+*/
+float getUIConM(cv::Mat gray);
+
+/*
+    @brief      Computes the Underwater Image Quality Measure (UIQM)
+    @function   float getUIQM(float UICM, float UISM, float UIConM)
+*/
+float getUIQM(float UICM, float UISM, float UIConM);
+
 /*
     @brief      Computes the intensity distribution histogram
     @function   void getHistogram(cv::Mat *channel, cv::Mat *hist)
@@ -107,6 +186,191 @@ void getHistogram(cv::Mat *channel, cv::Mat *hist);
 */
 cv::Mat printHist(cv::Mat histogram, Scalar color);
 
+/*
+    @brief      Computes the entropy of an intensity distribution histogram according to the Shannon Index
+    @function   float histEntropy(cv::Mat hist)
+*/
+float histEntropy(cv::Mat hist);
+
+/*
+    @brief      Parameters of the metrics. The features are counted with the detector (SURF, ORB, FAST or AKAZE) on a grid
+                of grid x grid cells keeping at most cellMax features in each one (all: 0). The sharpness is computed in
+                tiles of tile x tile pixels if tile is not 0
+*/
+struct metricParams {
+    std::string detector = "SURF";
+    int grid = 1;
+    int cellMax = 0;
+    int tile = 0;                           // Tile size of the sharpness (whole image: 0)
+    bool sharpnessMap = false;              // Sharpness of every tile
+    bool histogramImages = false;           // Images of the histograms besides their counts
+};
+
+/*
+    @brief      Name of the detector used for the given name: the same name, ORB for SURF without the contrib modules, or an
+                empty string if the name is not a detector
+    @function   std::string featureDetector(std::string name)
+*/
+std::string featureDetector(std::string name);
+
+/*
+    @brief      Counts the features detected without computing their descriptors
+    @function   int countFeatures(cv::Mat gray, const metricParams &params)
+*/
+int countFeatures(cv::Mat gray, const metricParams &params);
+
+/*
+    @brief      Results of the evaluation engine. Only the metrics in the metrics string are computed
+*/
+struct qualityMetrics {
+    std::string metrics;                    // Metrics computed, in the order they were requested
+    float entropy = NAN, AE = NAN, AC = NAN, AL = NAN, NNF = NAN, CAF = NAN, IQM = NAN, MSE = NAN, PSNR = NAN;   // NaN if not computed
+    float UCIQE = NAN, UICM = NAN, UISM = NAN, UIConM = NAN, UIQM = NAN;
+    float SSIM = NAN;                       // Structural similarity of the grayscale images
+    fullReference channels;                 // MSE, PSNR and SSIM of every channel
+    cv::Mat sharpnessMap;                   // Sharpness of every tile
+    int features = -1;
+    cv::Mat histRGB[3], histLAB[3];         // Intensity distribution histograms of the RGB and CIELab channels
+};
+
+/*
+    @brief      Expands the metric options, X stands for all the metrics (the full reference ones only with a reference)
+    @function   std::string planMetrics(std::string metric, bool reference)
+*/
+std::string planMetrics(std::string metric, bool reference);
+
+/*
+    @brief      Computes a set of metrics in a single pass. The gray image, the RGB and CIELab channels and their
+                histograms are computed once and shared by the metrics, and the independent metrics run in parallel
+    @function   qualityMetrics evaluateMetrics(cv::Mat src, cv::Mat ref, std::string metrics, const metricParams &params)
+*/
+qualityMetrics evaluateMetrics(cv::Mat src, cv::Mat ref, std::string metrics, const metricParams &params = metricParams());
+
+/*
+    @brief      Creates the image of the RGB and CIELab histograms of an evaluation, the colors of the a* and b* histograms
+                depend on their mean
+    @function   cv::Mat histogramImage(const qualityMetrics &r)
+*/
+cv::Mat histogramImage(const qualityMetrics &r);
+
+/*
+    @brief      Saves the counts of the RGB and CIELab histograms in a csv file, one line per channel ('B;c0;c1;...;c255')
+    @function   bool saveHistograms(std::string file, const qualityMetrics &r)
+*/
+bool saveHistograms(std::string file, const qualityMetrics &r);
+
+/*
+    @brief      Loads the histograms saved by saveHistograms so they can be rendered later
+    @function   bool loadHistograms(std::string file, qualityMetrics &r)
+*/
+bool loadHistograms(std::string file, qualityMetrics &r);
+
+/*
+    @brief      Formats the metrics of an image as a row of the csv file ('name;m1;m2;...') or as a JSON line
+    @function   std::string metricsRow(std::string name, const qualityMetrics &r, bool json)
+*/
+std::string metricsRow(std::string name, const qualityMetrics &r, bool json);
+
+/*
+    @brief      Gets the name, value and decimals of a metric of the results, false for the options without a value
+    @function   bool metricValue(const qualityMetrics &r, char metric, const char **key, double *value, int *precision)
+*/
+bool metricValue(const qualityMetrics &r, char metric, const char **key, double *value, int *precision);
+
+/*
+    @brief      True for the image files of a batch (by extension), the histograms saved by a previous run are left out
+    @function   bool isImage(const std::string &file)
+*/
+bool isImage(const std::string &file);
+
+/*
+    @brief      Processed and original images of a batch, the name identifies the pair in the results
+*/
+struct imagePair {
+    std::string processed, original, name;
+};
+
+/*
+    @brief      Lists the image pairs of a batch, from a directory of processed images and a directory of the originals with
+                the same file names, or from a manifest file (.txt or .csv) with a 'processed;original' pair per line
+    @function   std::vector<imagePair> listPairs(std::string processed, std::string original)
+*/
+std::vector<imagePair> listPairs(std::string processed, std::string original);
+
+/*
+    @brief      Single sink of the batch results shared by the workers. The rows go through one buffered stream that is
+                flushed every few rows, and when resuming the images already in the file are skipped
+*/
+class resultSink {
+public:
+    resultSink(std::string file, bool json, bool resume);
+    ~resultSink();
+    bool isOpen() const { return out.is_open(); }
+    bool done(const std::string &name, const std::string &plan) const;  // True if a previous run wrote the whole row of the image
+    void write(const std::string &name, const qualityMetrics &r);
+
+private:
+    ofstream out;
+    std::mutex lock;
+    std::map<std::string, int> previous;                // Rows of a previous run and the separators of the CSV ones
+    bool json;
+    int pending;                                        // Rows written since the last flush
+};
+
+/*
+    @brief      Computes a fast 64 bit hash of the bytes of a file, 0 if it can not be read
+    @function   uint64 fileHash(std::string file)
+*/
+uint64 fileHash(std::string file);
+
+/*
+    @brief      On disk cache of the metric values. Each value is keyed by the hash of the image files (of both images for the
+                full reference metrics), the metric and its parameters. The file is loaded once and the new values are
+                appended with a single write per line, so the workers of a batch and several processes can share it
+*/
+class metricCache {
+public:
+    metricCache(std::string file);
+    bool isOpen() const { return out.is_open(); }
+    std::string fetch(qualityMetrics &r, const std::string &metrics, uint64 src, uint64 ref, const metricParams &params);  // Fills the cached metrics and returns the missing ones
+    void store(const qualityMetrics &r, const std::string &metrics, uint64 src, uint64 ref, const metricParams &params);
+    int hits() const { return hitCount; }
+    int misses() const { return missCount; }
+
+private:
+    std::string key(char metric, uint64 src, uint64 ref, const metricParams &params) const;
+
+    std::map<std::string, std::vector<double>> entries;
+    std::mutex lock;
+    ofstream out;
+    std::atomic<int> hitCount, missCount;
+};
+
+/*
+    @brief      Evaluates the image pairs of a batch with a pool of workers, returns the number of pairs evaluated. The images
+                whose metrics are all in the cache (if not NULL) are not decoded
+    @function   int evaluateBatch(const std::vector<imagePair> &pairs, std::string metric, const metricParams &params, resultSink &sink, metricCache *cache, int workers, int *skipped, int *failed)
+*/
+int evaluateBatch(const std::vector<imagePair> &pairs, std::string metric, const metricParams &params, resultSink &sink, metricCache *cache, int workers, int *skipped, int *failed);
+
+/*
+    @brief      Summary of a metric over the frames of a video
+*/
+struct metricStats {
+    std::string key;
+    int precision;
+    double mean, stddev, min, max;
+};
+
+/*
+    @brief      Evaluates a processed video frame by frame against the original one (the same file for no reference metrics).
+                Both videos are decoded in lockstep and the frames are evaluated by a pool of workers, with at most one
+                frame pair per worker in memory. The metrics of every frame go in order to the sink and the summary of each
+                metric is returned, the function returns the number of frames evaluated
+    @function   int evaluateVideo(std::string processed, std::string original, std::string metric, const metricParams &params, resultSink &sink, int workers, std::vector<metricStats> *summary)
+*/
+int evaluateVideo(std::string processed, std::string original, std::string metric, const metricParams &params, resultSink &sink, int workers, std::vector<metricStats> *summary);
+
 #if USE_GPU
 float entropy_GPU(cv::cuda::GpuMat img);
 
@@ -119,4 +383,6 @@ float averageLuminance_GPU(cv::cuda::GpuMat L);
 float getMSE_GPU(cv::cuda::GpuMat src, cv::cuda::GpuMat dst);
 
 float sharpness_GPU(cv::cuda::GpuMat srcGPU);
-#endif
\ No newline at end of file
+#endif
+
+}	// namespace evaluationmetrics
\ No newline at end of file
@@ -15,9 +15,16 @@
 /// Include auxiliary utility libraries
 #include "../include/evaluationmetrics.h"
 
+namespace evaluationmetrics {
+
 float entropy(cv::Mat img) {
-    cv::Mat hist, normhist, prob, logP;
+    cv::Mat hist;
     getHistogram(&img, &hist);
+    return histEntropy(hist);
+}
+
+float histEntropy(cv::Mat hist) {
+    cv::Mat normhist, prob, logP;
     normalize(hist, normhist, 0, 1, NORM_MINMAX);               // Normalized histogram
     prob = normhist / sum(normhist).val[0];                     // Probability
     prob += 0.00000001;                                         // Added 0.00000001 to avoid errors calculating the logarithm
@@ -64,13 +71,125 @@ float getCAF(float AE, float AC, float NNF) {
 }
 
 float getMSE(cv::Mat src, cv::Mat dst) {
-    cv::Mat diff(src.rows, src.cols, CV_32F);
-    absdiff(src, dst, diff);
-    pow(diff, 2, diff);
-    float mse = sum(diff)[0] / src.total();                             // Mean Square Error
+    float mse = norm(src, dst, NORM_L2SQR) / src.total();               // Mean Square Error
     return mse;
 }
 
+#define SSIM_RADIUS 5                                                   // Radius of the 11x11 Gaussian window of the SSIM
+
+class referenceBands : public ParallelLoopBody {                        // Full reference metrics of a range of row bands
+public:
+    referenceBands(const cv::Mat &src, const cv::Mat &ref, int bands, bool ssim, std::vector<double> &sums)
+        : src(src), ref(ref), bands(bands), ssim(ssim), sums(sums) {
+        double total = 0;
+        for (int k = 0; k < 2 * SSIM_RADIUS + 1; k++) total += g[k] = exp(-(k - SSIM_RADIUS) * (k - SSIM_RADIUS) / (2 * 1.5 * 1.5));
+        for (int k = 0; k < 2 * SSIM_RADIUS + 1; k++) g[k] /= total;
+    }
+
+    void operator()(const Range &range) const {
+        for (int b = range.start; b < range.end; b++) band(b);
+    }
+
+private:
+    // Splits a row of both images in B, G, R and gray planes, accumulating the squared error of the own rows of the band
+    void planes(int y, float *a, float *b, double *error) const {
+        const uchar *p = src.ptr<uchar>(y), *q = ref.ptr<uchar>(y);
+        int cols = src.cols;
+        int64 sq[4] = { 0, 0, 0, 0 };
+        for (int x = 0; x < cols; x++, p += 3, q += 3) {
+            int gp = (p[0] * 1868 + p[1] * 9617 + p[2] * 4899 + (1 << 13)) >> 14;   // Same rounding as cvtColor
+            int gq = (q[0] * 1868 + q[1] * 9617 + q[2] * 4899 + (1 << 13)) >> 14;
+            int d0 = p[0] - q[0], d1 = p[1] - q[1], d2 = p[2] - q[2], d3 = gp - gq;
+            sq[0] += d0 * d0, sq[1] += d1 * d1, sq[2] += d2 * d2, sq[3] += d3 * d3;
+            if (a) {
+                a[x] = p[0], a[cols + x] = p[1], a[2 * cols + x] = p[2], a[3 * cols + x] = (float)gp;
+                b[x] = q[0], b[cols + x] = q[1], b[2 * cols + x] = q[2], b[3 * cols + x] = (float)gq;
+            }
+        }
+        if (error) for (int c = 0; c < 4; c++) error[c] += (double)sq[c];
+    }
+
+    // Horizontal Gaussian sums of x, y, x^2, y^2 and xy of every plane for the valid window centres
+    void filter(const float *a, const float *b, float *dst) const {
+        int cols = src.cols, valid = cols - 2 * SSIM_RADIUS;
+        for (int c = 0; c < 4; c++) {
+            const float *u = a + c * cols, *v = b + c * cols;
+            float *m = dst + c * 5 * valid;
+            for (int x = 0; x < valid; x++) {
+                float mx = 0, my = 0, xx = 0, yy = 0, xy = 0;
+                for (int k = 0; k < 2 * SSIM_RADIUS + 1; k++) {
+                    float w = g[k], p = u[x + k], q = v[x + k];
+                    mx += w * p, my += w * q, xx += w * p * p, yy += w * q * q, xy += w * p * q;
+                }
+                m[x] = mx, m[valid + x] = my, m[2 * valid + x] = xx, m[3 * valid + x] = yy, m[4 * valid + x] = xy;
+            }
+        }
+    }
+
+    void band(int b) const {
+        const int r = SSIM_RADIUS, w = 2 * SSIM_RADIUS + 1;
+        int rows = src.rows, cols = src.cols, valid = cols - 2 * r;
+        int y0 = rows * b / bands, y1 = rows * (b + 1) / bands;
+        int c0 = std::max(y0, r), c1 = std::min(y1, rows - r);     // Window centres of the band
+        double *out = &sums[b * 9];                                 // Squared errors, SSIM sums and number of windows
+
+        if (!ssim || c1 <= c0 || valid <= 0) {
+            for (int y = y0; y < y1; y++) planes(y, NULL, NULL, out);
+            return;
+        }
+
+        // Ring of the horizontally filtered rows, the vertical window slides over it
+        std::vector<float> a(4 * cols), bb(4 * cols), ring(w * 20 * valid);
+        const double C1 = (0.01 * 255) * (0.01 * 255), C2 = (0.03 * 255) * (0.03 * 255);
+        for (int y = c0 - r; y < c1 + r; y++) {
+            planes(y, &a[0], &bb[0], (y >= y0 && y < y1) ? out : NULL);
+            filter(&a[0], &bb[0], &ring[(y % w) * 20 * valid]);
+            int c = y - r;                                          // Centre whose window is complete
+            if (c < c0) continue;
+            for (int p = 0; p < 4; p++) {
+                double total = 0;
+                for (int x = 0; x < valid; x++) {
+                    float m[5] = { 0, 0, 0, 0, 0 };
+                    for (int k = 0; k < w; k++) {
+                        const float *row = &ring[((c - r + k) % w) * 20 * valid + p * 5 * valid];
+                        for (int j = 0; j < 5; j++) m[j] += g[k] * row[j * valid + x];
+                    }
+                    double mx = m[0], my = m[1];
+                    double vx = m[2] - mx * mx, vy = m[3] - my * my, cxy = m[4] - mx * my;
+                    total += ((2 * mx * my + C1) * (2 * cxy + C2)) / ((mx * mx + my * my + C1) * (vx + vy + C2));
+                }
+                out[4 + p] += total;
+            }
+        }
+        out[8] += (double)(c1 - c0) * valid;
+    }
+
+    const cv::Mat &src, &ref;
+    int bands;
+    bool ssim;
+    std::vector<double> &sums;
+    float g[2 * SSIM_RADIUS + 1];
+};
+
+fullReference compareImages(cv::Mat src, cv::Mat ref, bool ssim) {
+    CV_Assert(src.size() == ref.size() && src.type() == CV_8UC3 && ref.type() == CV_8UC3);
+    int bands = std::max(1, std::min(src.rows / (4 * SSIM_RADIUS), 4 * getNumberOfCPUs()));
+    std::vector<double> sums(bands * 9, 0);
+    parallel_for_(Range(0, bands), referenceBands(src, ref, bands, ssim, sums));
+
+    fullReference result;
+    double windows = 0;
+    for (int b = 0; b < bands; b++) windows += sums[b * 9 + 8];
+    for (int c = 0; c < 4; c++) {
+        double error = 0, total = 0;
+        for (int b = 0; b < bands; b++) error += sums[b * 9 + c], total += sums[b * 9 + 4 + c];
+        result.MSE[c] = error / src.total();
+        result.PSNR[c] = 20 * log10(255 / sqrt(result.MSE[c]));
+        result.SSIM[c] = windows > 0 ? total / windows : NAN;
+    }
+    return result;
+}
+
 float getPSNR(float mse) {
     float psnr = 20 * log10(255 / sqrt(mse));                               // Peak Signal to Noise Ratio
     return psnr;
@@ -96,6 +215,202 @@ float sharpness(cv::Mat src){
     return IQM;
 }
 
+class sharpnessTiles : public ParallelLoopBody {                // Sharpness of a range of tiles
+public:
+    sharpnessTiles(const cv::Mat &src, int tile, int nx, cv::Mat &scores) : src(src), tile(tile), nx(nx), scores(scores) {}
+
+    void operator()(const Range &range) const {
+        cv::Mat patch, spectrum;                                // Buffers reused by every tile of the range
+        for (int k = range.start; k < range.end; k++) {
+            int x = std::min(k % nx * tile, src.cols - tile), y = std::min(k / nx * tile, src.rows - tile);
+            src(Rect(x, y, tile, tile)).convertTo(patch, CV_32F);
+            dft(patch, spectrum, DFT_COMPLEX_OUTPUT);           // Real input, the conjugate half is filled by symmetry
+            float max2 = 0;
+            for (int i = 0; i < tile; i++) {                    // Squared magnitudes avoid the square roots
+                const float *c = spectrum.ptr<float>(i);
+                for (int j = 0; j < 2 * tile; j += 2) max2 = std::max(max2, c[j] * c[j] + c[j + 1] * c[j + 1]);
+            }
+            float thresh2 = max2 / (1000.0f * 1000.0f);         // Threshold of the IQM, max/1000 of the magnitude
+            int TH = 0;
+            for (int i = 0; i < tile; i++) {
+                const float *c = spectrum.ptr<float>(i);
+                for (int j = 0; j < 2 * tile; j += 2) TH += c[j] * c[j] + c[j + 1] * c[j + 1] > thresh2;
+            }
+            scores.at<float>(k / nx, k % nx) = (float)TH / (tile * tile);
+        }
+    }
+
+private:
+    const cv::Mat &src;
+    int tile, nx;
+    cv::Mat &scores;
+};
+
+float sharpnessTiled(cv::Mat src, int tile, cv::Mat *map) {
+    tile = getOptimalDFTSize(tile);
+    if (tile > src.cols || tile > src.rows) {                   // Smaller images have a single spectrum
+        float IQM = sharpness(src);
+        if (map) map->create(1, 1, CV_32F), map->setTo(Scalar::all(IQM));
+        return IQM;
+    }
+    int nx = (src.cols + tile - 1) / tile, ny = (src.rows + tile - 1) / tile;
+    cv::Mat scores(ny, nx, CV_32F);
+    parallel_for_(Range(0, nx * ny), sharpnessTiles(src, tile, nx, scores));
+    if (map) *map = scores;
+    float IQM = mean(scores)[0];                                // Mean sharpness of the tiles
+    return IQM;
+}
+
+cv::Mat sharpnessImage(cv::Mat map, cv::Size size) {
+    double max;
+    cv::Mat scaled, image;
+    minMaxIdx(map, NULL, &max);
+    map.convertTo(scaled, CV_8U, max > 0 ? 255 / max : 0);
+    resize(scaled, image, size, 0, 0, INTER_NEAREST);
+    return image;
+}
+
+float getUCIQE(cv::Mat lab) {
+    // Tables of the chroma of every (a*, b*) pair and of the inverse of the lightness, with L*, a* and b* divided by 100
+    static const std::vector<float> chroma = [] {
+        std::vector<float> table(256 * 256);
+        for (int a = 0; a < 256; a++)
+            for (int b = 0; b < 256; b++) table[a * 256 + b] = sqrt(float((a - 128) * (a - 128) + (b - 128) * (b - 128))) / 100;
+        return table;
+    }();
+    float inverse[256];
+    inverse[0] = 0;                                             // The saturation of black is 0
+    for (int l = 1; l < 256; l++) inverse[l] = 255.0f / l;
+
+    double sumC = 0, sumC2 = 0, sumS = 0;
+    std::vector<int64> hist(256, 0);                            // Lightness histogram for the percentiles
+    for (int y = 0; y < lab.rows; y++) {
+        const uchar *p = lab.ptr<uchar>(y);
+        float rowC = 0, rowC2 = 0, rowS = 0;
+        for (int x = 0; x < lab.cols; x++, p += 3) {
+            float c = chroma[p[1] * 256 + p[2]];
+            rowC += c;
+            rowC2 += c * c;
+            rowS += c * inverse[p[0]];
+            hist[p[0]]++;
+        }
+        sumC += rowC, sumC2 += rowC2, sumS += rowS;
+    }
+    double n = (double)lab.total();
+    double sigmaC = sqrt(std::max(0.0, sumC2 / n - (sumC / n) * (sumC / n)));    // Standard deviation of the chroma
+
+    int low = -1, high = -1;                                    // Contrast of the lightness between its 1 % and 99 % percentiles
+    int64 count = 0;
+    for (int l = 0; l < 256; l++) {
+        count += hist[l];
+        if (low < 0 && count >= 0.01 * n) low = l;
+        if (high < 0 && count >= 0.99 * n) high = l;
+    }
+    double conL = (high - low) / 255.0;
+
+    float UCIQE = 0.4680 * sigmaC + 0.2745 * conL + 0.2576 * sumS / n;
+    return UCIQE;
+}
+
+static double trimmedMean(const std::vector<int64> &hist, int offset, double scale, int64 n, double alpha) {
+    int64 first = (int64)ceil(alpha * n), last = n - (int64)floor(alpha * n);  // Ranks kept by the alpha trimmed mean
+    double sum = 0;
+    int64 rank = 0;
+    for (size_t i = 0; i < hist.size() && rank < last; i++) {
+        int64 lo = std::max(rank, first), hi = std::min(rank + hist[i], last);
+        if (hi > lo) sum += (hi - lo) * ((int)i - offset) * scale;
+        rank += hist[i];
+    }
+    return sum / std::max<int64>(1, last - first);
+}
+
+static double variance(const std::vector<int64> &hist, int offset, double scale, int64 n, double mu) {
+    double sum = 0;
+    for (size_t i = 0; i < hist.size(); i++) {
+        double d = ((int)i - offset) * scale - mu;
+        sum += hist[i] * d * d;
+    }
+    return sum / n;
+}
+
+float getUICM(std::vector<Mat> chanRGB) {
+    // Histograms of RG = R - G and of 2 YB = R + G - 2 B replace the sorting of the trimmed mean
+    std::vector<int64> histRG(511, 0), histYB(1021, 0);
+    for (int y = 0; y < chanRGB[0].rows; y++) {
+        const uchar *B = chanRGB[0].ptr<uchar>(y), *G = chanRGB[1].ptr<uchar>(y), *R = chanRGB[2].ptr<uchar>(y);
+        for (int x = 0; x < chanRGB[0].cols; x++) {
+            histRG[R[x] - G[x] + 255]++;
+            histYB[R[x] + G[x] - 2 * B[x] + 510]++;
+        }
+    }
+    int64 n = (int64)chanRGB[0].total();
+    double muRG = trimmedMean(histRG, 255, 1.0, n, 0.1), muYB = trimmedMean(histYB, 510, 0.5, n, 0.1);
+    double s2RG = variance(histRG, 255, 1.0, n, muRG), s2YB = variance(histYB, 510, 0.5, n, muYB);
+    float UICM = -0.0268 * sqrt(muRG * muRG + muYB * muYB) + 0.1586 * sqrt(s2RG + s2YB);
+    return UICM;
+}
+
+static void blockRange(const cv::Mat &img, int window, cv::Mat &mins, cv::Mat &maxs) {    // Minimum and maximum of each block
+    int k1 = img.cols / window, k2 = img.rows / window;
+    mins.create(k2, k1, CV_32F), maxs.create(k2, k1, CV_32F);
+    mins.setTo(Scalar::all(FLT_MAX)), maxs.setTo(Scalar::all(-FLT_MAX));
+    for (int y = 0; y < k2 * window; y++) {
+        const float *p = img.ptr<float>(y);
+        float *lo = mins.ptr<float>(y / window), *hi = maxs.ptr<float>(y / window);
+        for (int x = 0; x < k1 * window; x++) {
+            int k = x / window;
+            lo[k] = std::min(lo[k], p[x]);
+            hi[k] = std::max(hi[k], p[x]);
+        }
+    }
+}
+
+float getUISM(std::vector<Mat> chanRGB) {
+    const float lambda[3] = { 0.114f, 0.587f, 0.299f };        // Weights of the B, G and R channels
+    const int window = 10;
+    float UISM = 0;
+    for (int c = 0; c < 3; c++) {
+        cv::Mat dx, dy, edges(chanRGB[c].size(), CV_32F), mins, maxs;
+        Sobel(chanRGB[c], dx, CV_16S, 1, 0);
+        Sobel(chanRGB[c], dy, CV_16S, 0, 1);
+        for (int y = 0; y < edges.rows; y++) {                  // Sobel magnitude times the channel
+            const short *gx = dx.ptr<short>(y), *gy = dy.ptr<short>(y);
+            const uchar *p = chanRGB[c].ptr<uchar>(y);
+            float *e = edges.ptr<float>(y);
+            for (int x = 0; x < edges.cols; x++) e[x] = sqrt(float(gx[x] * gx[x] + gy[x] * gy[x])) * p[x];
+        }
+        blockRange(edges, window, mins, maxs);
+        double EME = 0;
+        for (int k = 0; k < (int)mins.total(); k++) {
+            float lo = mins.at<float>(k), hi = maxs.at<float>(k);
+            if (lo > 0 && hi > 0) EME += log(hi / lo);
+        }
+        UISM += lambda[c] * 2 * EME / std::max<size_t>(1, mins.total());
+    }
+    return UISM;
+}
+
+float getUIConM(cv::Mat gray) {
+    cv::Mat intensity, mins, maxs;
+    gray.convertTo(intensity, CV_32F);
+    blockRange(intensity, 10, mins, maxs);
+    double logAMEE = 0;
+    for (int k = 0; k < (int)mins.total(); k++) {
+        float lo = mins.at<float>(k), hi = maxs.at<float>(k);
+        if (hi - lo > 0 && hi + lo > 0) {
+            double ratio = (hi - lo) / (hi + lo);
+            logAMEE += ratio * log(ratio);
+        }
+    }
+    float UIConM = -logAMEE / std::max<size_t>(1, mins.total());
+    return UIConM;
+}
+
+float getUIQM(float UICM, float UISM, float UIConM) {
+    float UIQM = 0.0282 * UICM + 0.2953 * UISM + 3.5753 * UIConM;                   // Underwater Image Quality Measure
+    return UIQM;
+}
+
 void getHistogram(cv::Mat *channel, cv::Mat *hist) {        // Computes the intensity distribution histogram
     int histSize = 256;
     float range[] = { 0, 256 };
@@ -136,6 +451,647 @@ cv::Mat printHist(cv::Mat histogram, Scalar color) {
     return imgHist;
 }
 
+std::string featureDetector(std::string name) {
+#ifndef HAVE_OPENCV_XFEATURES2D
+    if (name == "SURF") return "ORB";                           // SURF needs the contrib modules
+#endif
+    if (name == "SURF" || name == "ORB" || name == "FAST" || name == "AKAZE") return name;
+    return "";
+}
+
+static cv::Ptr<Feature2D> createDetector(const std::string &name) {
+    std::string used = featureDetector(name);
+    CV_Assert(!used.empty());
+    if (used == "ORB") return ORB::create(1 << 20);            // No limit on the number of features
+    if (used == "FAST") return FastFeatureDetector::create();
+    if (used == "AKAZE") return AKAZE::create();
+#ifdef HAVE_OPENCV_XFEATURES2D
+    int minHessian = 400;
+    return SURF::create(minHessian);
+#else
+    return cv::Ptr<Feature2D>();
+#endif
+}
+
+class featureCells : public ParallelLoopBody {                  // Counts the features of a range of grid cells
+public:
+    featureCells(const cv::Mat &gray, const metricParams &params, std::vector<int> &counts)
+        : gray(gray), params(params), counts(counts) {}
+
+    void operator()(const Range &range) const {
+        const int margin = 32;                                  // Border needed by the detectors around the cell
+        cv::Ptr<Feature2D> detector = createDetector(params.detector);
+        Rect image(0, 0, gray.cols, gray.rows);
+        for (int k = range.start; k < range.end; k++) {
+            int gx = k % params.grid, gy = k / params.grid;
+            Rect cell(gx * gray.cols / params.grid, gy * gray.rows / params.grid, 0, 0);
+            cell.width = (gx + 1) * gray.cols / params.grid - cell.x;
+            cell.height = (gy + 1) * gray.rows / params.grid - cell.y;
+            Rect outer = Rect(cell.x - margin, cell.y - margin, cell.width + 2 * margin, cell.height + 2 * margin) & image;
+            std::vector<KeyPoint> keypoint, inside;
+            detector->detect(gray(outer), keypoint);
+            for (size_t i = 0; i < keypoint.size(); i++) {      // Only the features of the cell itself
+                Point2f p = keypoint[i].pt + Point2f((float)outer.x, (float)outer.y);
+                if (cell.contains(Point((int)p.x, (int)p.y))) inside.push_back(keypoint[i]);
+            }
+            if (params.cellMax > 0) KeyPointsFilter::retainBest(inside, params.cellMax);   // Strongest features of the cell
+            counts[k] = (int)std::min(inside.size(), params.cellMax > 0 ? (size_t)params.cellMax : inside.size());
+        }
+    }
+
+private:
+    const cv::Mat &gray;
+    const metricParams &params;
+    std::vector<int> &counts;
+};
+
+int countFeatures(cv::Mat gray, const metricParams &params) {
+    std::vector<KeyPoint> keypoint;
+    if (params.grid <= 1 && params.cellMax <= 0) {             // Whole image, only the keypoints are detected
+        createDetector(params.detector)->detect(gray, keypoint);
+        return (int)keypoint.size();
+    }
+    int grid = std::max(1, params.grid);
+    std::vector<int> counts(grid * grid, 0);
+    metricParams cells = params;
+    cells.grid = grid;
+    parallel_for_(Range(0, grid * grid), featureCells(gray, cells, counts));
+    int total = 0;
+    for (size_t k = 0; k < counts.size(); k++) total += counts[k];
+    return total;
+}
+
+std::string planMetrics(std::string metric, bool reference) {
+    std::string plan;
+    for (size_t i = 0; i < metric.size(); i++) {
+        if (metric[i] == 'X') plan += reference ? "EACLNFSUMPYQIH" : "EACLNFSUQIH";  // All metrics
+        else plan += metric[i];
+    }
+    return plan;
+}
+
+class metricTasks : public ParallelLoopBody {                   // Computes the independent metrics in parallel
+public:
+    metricTasks(const std::string &tasks, const cv::Mat &src, const cv::Mat &ref, const cv::Mat &graysrc, const cv::Mat &src_LAB, const std::vector<Mat> &chanRGB,
+        const metricParams &params, qualityMetrics &r)
+        : tasks(tasks), src(src), ref(ref), graysrc(graysrc), src_LAB(src_LAB), chanRGB(chanRGB), params(params), r(r) {}
+
+    void operator()(const Range &range) const {
+        for (int k = range.start; k < range.end; k++) {
+            switch (tasks[k]) {
+                case 'C': r.AC = averageContrast(chanRGB); break;
+                case 'S': r.IQM = params.tile > 0 ? sharpnessTiled(graysrc, params.tile, params.sharpnessMap ? &r.sharpnessMap : NULL) : sharpness(graysrc); break;
+                case 'U': r.features = countFeatures(graysrc, params); break;
+                case 'M': r.channels = compareImages(src, ref, r.metrics.find('Y') != std::string::npos); break;
+                case 'Q': r.UCIQE = getUCIQE(src_LAB); break;
+                case 'I': r.UICM = getUICM(chanRGB); break;
+                case 'J': r.UISM = getUISM(chanRGB); break;
+                case 'K': r.UIConM = getUIConM(graysrc); break;
+            }
+        }
+    }
+
+private:
+    const std::string &tasks;
+    const cv::Mat &src, &ref, &graysrc, &src_LAB;
+    const std::vector<Mat> &chanRGB;
+    const metricParams &params;
+    qualityMetrics &r;
+};
+
+qualityMetrics evaluateMetrics(cv::Mat src, cv::Mat ref, std::string metrics, const metricParams &params) {
+    qualityMetrics r;
+    r.metrics = metrics;
+    auto needs = [&](const char *set) { return metrics.find_first_of(set) != std::string::npos; };
+
+    // Shared intermediates, each one computed once
+    cv::Mat graysrc, src_LAB, chanLAB[3];
+    std::vector<Mat> chanRGB;
+    if (needs("ESUI")) cvtColor(src, graysrc, COLOR_BGR2GRAY);
+    if (needs("ACFHI")) split(src, chanRGB);
+    if (needs("LNFHQ")) cvtColor(src, src_LAB, COLOR_BGR2Lab);
+    if (needs("LNFH")) split(src_LAB, chanLAB);
+    if (needs("AFH")) for (int c = 0; c < 3; c++) getHistogram(&chanRGB[c], &r.histRGB[c]);
+    if (needs("H")) {
+        for (int c = 0; c < 3; c++) getHistogram(&chanLAB[c], &r.histLAB[c]);
+    }
+
+    // The expensive metrics do not depend on each other
+    std::string tasks;
+    if (needs("CF")) tasks += 'C';
+    if (needs("S")) tasks += 'S';
+    if (needs("U")) tasks += 'U';
+    if (needs("MPY")) tasks += 'M';                             // MSE, PSNR and SSIM in one read of both images
+    if (needs("Q")) tasks += 'Q';
+    if (needs("I")) tasks += "IJK";                             // Components of the UIQM
+    parallel_for_(Range(0, (int)tasks.size()), metricTasks(tasks, src, ref, graysrc, src_LAB, chanRGB, params, r));
+
+    // Metrics derived from the shared histograms and from the other metrics
+    if (needs("E")) {
+        cv::Mat hist;
+        getHistogram(&graysrc, &hist);
+        r.entropy = histEntropy(hist);
+    }
+    if (needs("AF")) r.AE = sqrt((pow(histEntropy(r.histRGB[0]), 2) + pow(histEntropy(r.histRGB[1]), 2) + pow(histEntropy(r.histRGB[2]), 2)) / 3);
+    if (needs("LNF")) r.AL = averageLuminance(chanLAB[0]);
+    if (needs("NF")) r.NNF = getNNF(r.AL);
+    if (needs("F")) r.CAF = getCAF(r.AE, r.AC, r.NNF);
+    if (needs("MPY")) {                                         // The metrics of the grayscale images are the reported ones
+        r.MSE = r.channels.MSE[3];
+        r.PSNR = r.channels.PSNR[3];
+        r.SSIM = r.channels.SSIM[3];
+    }
+    if (needs("I")) r.UIQM = getUIQM(r.UICM, r.UISM, r.UIConM);
+    return r;
+}
+
+static double histMean(const cv::Mat &hist) {                  // Mean intensity of a histogram
+    double sum = 0, count = 0;
+    for (int i = 0; i < hist.rows; i++) sum += i * hist.at<float>(i), count += hist.at<float>(i);
+    return count > 0 ? sum / count : 0;
+}
+
+cv::Mat histogramImage(const qualityMetrics &r) {
+    cv::Mat RGB_hist[3], LAB_hist[3], histRGB, histLAB, hist;
+    Scalar colorA = histMean(r.histLAB[1]) > 127.5 ? Scalar(150, 15, 235) : Scalar(75, 155, 10);
+    Scalar colorB = histMean(r.histLAB[2]) > 127.5 ? Scalar(7, 217, 254) : Scalar(240, 210, 40);
+
+    // RGB histogram
+    RGB_hist[0] = printHist(r.histRGB[0], { 255,0,0 });
+    RGB_hist[1] = printHist(r.histRGB[1], { 0,255,0 });
+    RGB_hist[2] = printHist(r.histRGB[2], { 0,0,255 });
+    cv::vconcat(RGB_hist[0], RGB_hist[1], histRGB);
+    cv::vconcat(histRGB, RGB_hist[2], histRGB);
+
+    // LAB histogram
+    LAB_hist[0] = printHist(r.histLAB[0], { 0,0,0 });
+    LAB_hist[1] = printHist(r.histLAB[1], colorA);
+    LAB_hist[2] = printHist(r.histLAB[2], colorB);
+    cv::vconcat(LAB_hist[0], LAB_hist[1], histLAB);
+    cv::vconcat(histLAB, LAB_hist[2], histLAB);
+
+    // Histogram comparison
+    cv::hconcat(histRGB, histLAB, hist);
+    return hist;
+}
+
+bool saveHistograms(std::string file, const qualityMetrics &r) {
+    const char *names[6] = { "B", "G", "R", "L", "a", "b" };
+    std::ostringstream counts;
+    for (int c = 0; c < 6; c++) {
+        const cv::Mat &hist = c < 3 ? r.histRGB[c] : r.histLAB[c - 3];
+        counts << names[c];
+        for (int i = 0; i < hist.rows; i++) counts << ";" << (int64)hist.at<float>(i);
+        counts << "\n";
+    }
+    ofstream out(file);
+    out << counts.str();
+    return out.good();
+}
+
+bool loadHistograms(std::string file, qualityMetrics &r) {
+    ifstream in(file);
+    std::string line;
+    int c = 0;
+    for (; c < 6 && std::getline(in, line); c++) {
+        cv::Mat &hist = c < 3 ? r.histRGB[c] : r.histLAB[c - 3];
+        hist.create(256, 1, CV_32F);
+        hist.setTo(Scalar::all(0));
+        std::size_t pos = line.find(';');
+        for (int i = 0; i < 256 && pos != std::string::npos; i++, pos = line.find(';', pos + 1)) hist.at<float>(i) = (float)atof(line.c_str() + pos + 1);
+    }
+    return c == 6;
+}
+
+static std::string jsonString(const std::string &text) {        // Quoted and escaped JSON string
+    std::string quoted = "\"";
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '"' || text[i] == '\\') quoted += '\\';
+        quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+bool metricValue(const qualityMetrics &r, char metric, const char **key, double *value, int *precision) {
+    *precision = 3;
+    switch (metric) {
+        case 'E': *key = "entropy"; *value = r.entropy; break;
+        case 'A': *key = "AE"; *value = r.AE; break;
+        case 'C': *key = "AC"; *value = r.AC; break;
+        case 'L': *key = "AL"; *value = r.AL; break;
+        case 'N': *key = "NNF"; *value = r.NNF; *precision = 5; break;
+        case 'F': *key = "CAF"; *value = r.CAF; break;
+        case 'S': *key = "IQM"; *value = r.IQM; *precision = 5; break;
+        case 'U': *key = "features"; *value = r.features; *precision = 0; break;
+        case 'M': *key = "MSE"; *value = int(r.MSE); *precision = 0; break;
+        case 'P': *key = "PSNR"; *value = r.PSNR; break;
+        case 'Y': *key = "SSIM"; *value = r.SSIM; *precision = 5; break;
+        case 'Q': *key = "UCIQE"; *value = r.UCIQE; *precision = 5; break;
+        case 'I': *key = "UIQM"; *value = r.UIQM; *precision = 5; break;
+        default: return false;                                  // Histograms and unknown options have no value
+    }
+    return true;
+}
+
+std::string metricsRow(std::string name, const qualityMetrics &r, bool json) {
+    std::ostringstream row;
+    row << fixed;
+    if (json) row << "{\"file\":" << jsonString(name);
+    else row << endl << name << ";";
+    for (size_t i = 0; i < r.metrics.size(); i++) {
+        const char *key;
+        int precision;
+        double value;
+        if (!metricValue(r, r.metrics[i], &key, &value, &precision)) continue;
+        if (json) row << ",\"" << key << "\":";
+        row << setprecision(precision) << value;
+        if (!json) row << ";";
+    }
+    if (json) row << "}" << endl;
+    return row.str();
+}
+
+bool isImage(const std::string &file) {
+    std::string ext = file.substr(file.find_last_of('.') + 1);
+    for (size_t i = 0; i < ext.size(); i++) ext[i] = tolower(ext[i]);
+    if (file.size() > 9 && file.compare(file.size() - 9, 9, "_hist.jpg") == 0) return false;   // Histograms of a previous run
+    return ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "tif" || ext == "tiff" || ext == "bmp";
+}
+
+std::vector<imagePair> listPairs(std::string processed, std::string original) {
+    std::vector<imagePair> pairs;
+    std::string ext = processed.substr(processed.find_last_of('.') + 1);
+    if (processed.find_last_of('.') != std::string::npos && (ext == "txt" || ext == "csv")) {   // Manifest file
+        ifstream manifest(processed);
+        std::string line;
+        while (std::getline(manifest, line)) {
+            if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+            std::size_t sep = line.find_first_of(";,");
+            if (line.empty() || sep == std::string::npos) continue;
+            imagePair p;
+            p.processed = line.substr(0, sep);
+            p.original = line.substr(sep + 1);
+            p.name = p.processed;
+            pairs.push_back(p);
+        }
+        return pairs;
+    }
+    std::vector<cv::String> files;                              // Directory pair
+    cv::glob(processed, files, false);
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!isImage(files[i])) continue;
+        std::size_t pos = files[i].find_last_of("/\\");
+        imagePair p;
+        p.processed = files[i];
+        p.name = files[i].substr(pos + 1);
+        p.original = original + "/" + p.name;
+        if (original == processed) p.original = p.processed;    // No reference images
+        pairs.push_back(p);
+    }
+    return pairs;
+}
+
+resultSink::resultSink(std::string file, bool json, bool resume) : json(json), pending(0) {
+    bool cut = false;                                           // The file ends in a row cut by an interruption
+    if (resume) {                                               // Names of the images already evaluated
+        ifstream in(file);
+        std::string line;
+        while (std::getline(in, line)) {
+            cut = in.eof() && !line.empty();                    // Last line without its end of line
+            if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+            if (json) {
+                if (line.compare(0, 8, "{\"file\":") != 0 || line.empty() || line[line.size() - 1] != '}') continue;   // Incomplete rows are evaluated again
+                std::size_t end = line.find("\",", 8);
+                if (end == std::string::npos) end = line.find("\"}", 8);
+                if (end != std::string::npos) previous[line.substr(8, end - 7)] = -1;
+            }
+            else if (!line.empty()) previous[line.substr(0, line.find(';'))] = (int)std::count(line.begin(), line.end(), ';');
+        }
+    }
+    out.open(file, std::ios::app);
+    if (cut && json) out << endl;                               // The JSON rows end their line, so the next one starts a new line
+}
+
+resultSink::~resultSink() {
+    if (out.is_open()) out.flush();
+}
+
+bool resultSink::done(const std::string &name, const std::string &plan) const {
+    std::map<std::string, int>::const_iterator row = previous.find(json ? jsonString(name) : name);
+    if (row == previous.end()) return false;
+    if (json) return true;                                      // The JSON rows are complete once closed
+    qualityMetrics names = qualityMetrics();                    // The CSV rows have no end mark, their separators are counted
+    names.metrics = plan;
+    std::string empty = metricsRow("", names, false);
+    return row->second == (int)std::count(empty.begin(), empty.end(), ';');
+}
+
+void resultSink::write(const std::string &name, const qualityMetrics &r) {
+    std::string row = metricsRow(name, r, json);
+    std::lock_guard<std::mutex> guard(lock);
+    out << row;
+    if (++pending >= 32) {                                      // At most 32 rows are evaluated again after an interruption
+        out.flush();
+        pending = 0;
+    }
+}
+
+uint64 fileHash(std::string file) {
+    ifstream in(file, std::ios::binary);
+    if (!in.is_open()) return 0;
+    std::vector<char> buffer(1 << 20);
+    uint64 hash = 0x9E3779B97F4A7C15ULL, size = 0;
+    while (in) {
+        in.read(&buffer[0], buffer.size());
+        size_t n = (size_t)in.gcount(), k = 0;
+        for (; k + 8 <= n; k += 8) {                            // Eight bytes per step
+            uint64 word;
+            memcpy(&word, &buffer[k], 8);
+            hash = (hash ^ (word * 0xFF51AFD7ED558CCDULL)) * 0x100000001B3ULL;
+            hash ^= hash >> 29;
+        }
+        for (; k < n; k++) hash = (hash ^ (uchar)buffer[k]) * 0x100000001B3ULL;
+        size += n;
+    }
+    hash ^= size * 0xC4CEB9FE1A85EC53ULL;
+    return hash ? hash : 1;
+}
+
+// Values of a metric kept in the cache
+static std::vector<double> packMetric(const qualityMetrics &r, char metric) {
+    switch (metric) {
+        case 'E': return { r.entropy };
+        case 'A': return { r.AE };
+        case 'C': return { r.AC };
+        case 'L': return { r.AL };
+        case 'N': return { r.NNF };
+        case 'F': return { r.CAF };
+        case 'S': return { r.IQM };
+        case 'U': return { (double)r.features };
+        case 'M': return { r.MSE, r.channels.MSE[0], r.channels.MSE[1], r.channels.MSE[2], r.channels.MSE[3] };
+        case 'P': return { r.PSNR, r.channels.PSNR[0], r.channels.PSNR[1], r.channels.PSNR[2], r.channels.PSNR[3] };
+        case 'Y': return { r.SSIM, r.channels.SSIM[0], r.channels.SSIM[1], r.channels.SSIM[2], r.channels.SSIM[3] };
+        case 'Q': return { r.UCIQE };
+        case 'I': return { r.UIQM, r.UICM, r.UISM, r.UIConM };
+    }
+    return {};
+}
+
+static void unpackMetric(qualityMetrics &r, char metric, const std::vector<double> &v) {
+    switch (metric) {
+        case 'E': r.entropy = v[0]; break;
+        case 'A': r.AE = v[0]; break;
+        case 'C': r.AC = v[0]; break;
+        case 'L': r.AL = v[0]; break;
+        case 'N': r.NNF = v[0]; break;
+        case 'F': r.CAF = v[0]; break;
+        case 'S': r.IQM = v[0]; break;
+        case 'U': r.features = (int)v[0]; break;
+        case 'M': r.MSE = v[0]; for (int c = 0; c < 4; c++) r.channels.MSE[c] = v[c + 1]; break;
+        case 'P': r.PSNR = v[0]; for (int c = 0; c < 4; c++) r.channels.PSNR[c] = v[c + 1]; break;
+        case 'Y': r.SSIM = v[0]; for (int c = 0; c < 4; c++) r.channels.SSIM[c] = v[c + 1]; break;
+        case 'Q': r.UCIQE = v[0]; break;
+        case 'I': r.UIQM = v[0], r.UICM = v[1], r.UISM = v[2], r.UIConM = v[3]; break;
+    }
+}
+
+metricCache::metricCache(std::string file) : hitCount(0), missCount(0) {
+    ifstream in(file);
+    std::string line;
+    while (std::getline(in, line)) {                            // key|v1;v2;... where the key is version;hash;metric;parameters
+        std::size_t end = line.rfind('|');
+        if (end == std::string::npos || line.empty() || line[line.size() - 1] != ';') continue;    // Lines cut by an interruption
+        std::vector<double> values;
+        for (std::size_t pos = end + 1; pos < line.size(); pos = line.find(';', pos) + 1) values.push_back(strtod(line.c_str() + pos, NULL));
+        entries[line.substr(0, end)] = values;
+    }
+    out.open(file, std::ios::app);
+}
+
+std::string metricCache::key(char metric, uint64 src, uint64 ref, const metricParams &params) const {
+    std::ostringstream key;
+    key << "v1;" << std::hex << src;                            // Version of the metric implementations
+    if (metric == 'M' || metric == 'P' || metric == 'Y') key << "-" << ref;
+    key << ";" << metric;
+    if (metric == 'U') key << ";" << params.detector << "," << std::dec << params.grid << "," << params.cellMax;
+    if (metric == 'S') key << ";" << std::dec << params.tile;
+    return key.str();
+}
+
+std::string metricCache::fetch(qualityMetrics &r, const std::string &metrics, uint64 src, uint64 ref, const metricParams &params) {
+    std::string missing;
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < metrics.size(); i++) {
+        char m = metrics[i];
+        std::map<std::string, std::vector<double>>::const_iterator entry = entries.find(key(m, src, ref, params));
+        bool cacheable = !packMetric(r, m).empty() && !(m == 'S' && params.sharpnessMap);
+        if (cacheable && entry != entries.end() && entry->second.size() == packMetric(r, m).size()) {
+            unpackMetric(r, m, entry->second);
+            hitCount++;
+        }
+        else {
+            if (cacheable) missCount++;
+            if (missing.find(m) == std::string::npos) missing += m;
+        }
+    }
+    return missing;
+}
+
+void metricCache::store(const qualityMetrics &r, const std::string &metrics, uint64 src, uint64 ref, const metricParams &params) {
+    std::ostringstream lines;
+    std::vector<std::pair<std::string, std::vector<double>>> added;
+    for (size_t i = 0; i < metrics.size(); i++) {
+        std::vector<double> values = packMetric(r, metrics[i]);
+        if (values.empty() || (metrics[i] == 'S' && params.sharpnessMap)) continue;
+        std::string k = key(metrics[i], src, ref, params);
+        lines << k << "|" << setprecision(9);
+        for (size_t v = 0; v < values.size(); v++) lines << values[v] << ";";
+        lines << "\n";
+        added.push_back(std::make_pair(k, values));
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < added.size(); i++) entries[added[i].first] = added[i].second;
+    out << lines.str() << std::flush;                           // One write of whole lines
+}
+
+int evaluateBatch(const std::vector<imagePair> &pairs, std::string metric, const metricParams &params, resultSink &sink, metricCache *cache, int workers, int *skipped, int *failed) {
+    std::atomic<int> next(0), evaluated(0), skip(0), fail(0);
+
+    // Histogram images rendered by a background thread, off the evaluation of the images
+    std::deque<std::pair<std::string, qualityMetrics>> renders;
+    std::mutex renderLock;
+    std::condition_variable renderReady;
+    bool closed = false;
+    std::thread renderer;
+    if (params.histogramImages) renderer = std::thread([&]() {
+        while (true) {
+            std::pair<std::string, qualityMetrics> job;
+            {
+                std::unique_lock<std::mutex> lock(renderLock);
+                renderReady.wait(lock, [&] { return closed || !renders.empty(); });
+                if (renders.empty()) break;
+                job = renders.front();
+                renders.pop_front();
+            }
+            cv::imwrite(job.first, histogramImage(job.second));
+        }
+    });
+
+    auto work = [&]() {
+        for (int k = next++; k < (int)pairs.size(); k = next++) {
+            const imagePair &p = pairs[k];
+            std::string plan = planMetrics(metric, p.original != p.processed), missing = plan;
+            if (sink.done(p.name, plan)) {
+                skip++;
+                continue;
+            }
+            qualityMetrics r;
+            uint64 srcHash = 0, refHash = 0;
+            if (cache) {
+                srcHash = fileHash(p.processed);
+                refHash = p.original == p.processed ? srcHash : fileHash(p.original);
+                if (srcHash && refHash) missing = cache->fetch(r, plan, srcHash, refHash, params);
+            }
+            r.metrics = plan;
+            cv::Mat src;
+            if (!missing.empty()) {                             // Only the metrics not in the cache are computed
+                src = imread(p.processed, cv::IMREAD_COLOR);
+                cv::Mat dst = p.original == p.processed ? src : imread(p.original, cv::IMREAD_COLOR);
+                if (src.empty() || dst.empty()) {
+                    fail++;
+                    std::cerr << "Error occured when loading " + p.processed + " or " + p.original + "\n";
+                    continue;
+                }
+                qualityMetrics computed;
+                try {
+                    computed = evaluateMetrics(src, dst, missing, params);
+                }
+                catch (const cv::Exception &e) {                // A bad pair (e.g. sizes that differ) does not stop the batch
+                    fail++;
+                    std::cerr << "Error occured when evaluating " + p.processed + ": " + e.what() + "\n";
+                    continue;
+                }
+                for (size_t i = 0; i < missing.size(); i++) {
+                    std::vector<double> values = packMetric(computed, missing[i]);
+                    if (!values.empty()) unpackMetric(r, missing[i], values);
+                }
+                for (int c = 0; c < 3; c++) r.histRGB[c] = computed.histRGB[c], r.histLAB[c] = computed.histLAB[c];
+                r.sharpnessMap = computed.sharpnessMap;
+                if (cache && srcHash && refHash) cache->store(computed, missing, srcHash, refHash, params);
+            }
+            std::size_t pos = p.processed.find_last_of('.');
+            if (r.metrics.find('H') != std::string::npos) {
+                saveHistograms(p.processed.substr(0, pos) + "_hist.csv", r);
+                if (params.histogramImages) {
+                    std::lock_guard<std::mutex> lock(renderLock);
+                    renders.push_back(std::make_pair(p.processed.substr(0, pos) + "_hist.jpg", r));
+                    renderReady.notify_one();
+                }
+            }
+            if (!r.sharpnessMap.empty()) cv::imwrite(p.processed.substr(0, pos) + "_sharpness.png", sharpnessImage(r.sharpnessMap, src.size()));
+            sink.write(p.name, r);
+            evaluated++;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int i = 1; i < workers; i++) pool.push_back(std::thread(work));
+    work();
+    for (size_t i = 0; i < pool.size(); i++) pool[i].join();
+    if (renderer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(renderLock);
+            closed = true;
+        }
+        renderReady.notify_all();
+        renderer.join();
+    }
+    if (skipped) *skipped = skip;
+    if (failed) *failed = fail;
+    return evaluated;
+}
+
+int evaluateVideo(std::string processed, std::string original, std::string metric, const metricParams &params, resultSink &sink, int workers, std::vector<metricStats> *summary) {
+    cv::VideoCapture capSrc(processed), capRef;
+    bool reference = original != processed;
+    if (reference) capRef.open(original);
+    if (!capSrc.isOpened() || (reference && !capRef.isOpened())) return -1;
+
+    metric = planMetrics(metric, reference);
+    metric.erase(std::remove(metric.begin(), metric.end(), 'H'), metric.end());    // No histogram images per frame
+    metricParams frameParams = params;
+    frameParams.sharpnessMap = false;
+
+    std::mutex readLock, writeLock;
+    std::map<int, qualityMetrics> pending;                      // Frames evaluated before the previous ones
+    int read = 0, ordered = 0, written = 0;                     // Frames read, passed in order and written
+    bool finished = false;
+    std::vector<double> sum(metric.size(), 0), sum2(metric.size(), 0), lo(metric.size(), DBL_MAX), hi(metric.size(), -DBL_MAX);
+
+    auto work = [&]() {
+        cv::Mat src, ref;
+        while (true) {
+            int index;
+            {
+                std::lock_guard<std::mutex> guard(readLock);    // Both videos are decoded in lockstep
+                if (finished || !capSrc.read(src) || (reference && !capRef.read(ref))) {
+                    finished = true;
+                    break;
+                }
+                index = read++;
+            }
+            qualityMetrics r;                                   // Without metrics if the frame can not be evaluated
+            try {
+                r = evaluateMetrics(src, reference ? ref : src, metric, frameParams);
+            }
+            catch (const cv::Exception &e) {                    // E.g. a comparison video wider than the original
+                std::cerr << "Error occured when evaluating the frame " + std::to_string(index) + ": " + e.what() + "\n";
+            }
+            std::lock_guard<std::mutex> guard(writeLock);
+            pending[index] = r;
+            while (!pending.empty() && pending.begin()->first == ordered) {   // Frames written in order
+                const qualityMetrics &f = pending.begin()->second;
+                if (f.metrics.empty()) {
+                    pending.erase(pending.begin());
+                    ordered++;
+                    continue;
+                }
+                sink.write(std::to_string(ordered), f);
+                for (size_t i = 0; i < metric.size(); i++) {
+                    const char *key;
+                    int precision;
+                    double value;
+                    if (!metricValue(f, metric[i], &key, &value, &precision)) continue;
+                    sum[i] += value, sum2[i] += value * value;
+                    lo[i] = std::min(lo[i], value), hi[i] = std::max(hi[i], value);
+                }
+                pending.erase(pending.begin());
+                ordered++, written++;
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int i = 1; i < workers; i++) pool.push_back(std::thread(work));
+    work();
+    for (size_t i = 0; i < pool.size(); i++) pool[i].join();
+
+    if (summary) {
+        qualityMetrics names;
+        summary->clear();
+        for (size_t i = 0; i < metric.size() && written > 0; i++) {
+            metricStats stats;
+            const char *key;
+            double value;
+            if (!metricValue(names, metric[i], &key, &value, &stats.precision)) continue;
+            stats.key = key;
+            stats.mean = sum[i] / written;
+            stats.stddev = sqrt(std::max(0.0, sum2[i] / written - stats.mean * stats.mean));
+            stats.min = lo[i], stats.max = hi[i];
+            summary->push_back(stats);
+        }
+    }
+    return written;
+}
+
 #if USE_GPU
 float entropy_GPU(cv::cuda::GpuMat img) {
     cv::cuda::GpuMat hist, normhist, prob, logP, mult;
@@ -203,4 +1159,6 @@ float sharpness_GPU(cv::cuda::GpuMat srcGPU) {
     float IQM = TH / srcGPU.total();                        // Computes the Image Sharpness
     return IQM;
 }
-#endif
\ No newline at end of file
+#endif
+
+}	// namespace evaluationmetrics
\ No newline at end of file
@@ -16,6 +16,7 @@
 
 /// Include auxiliary utility libraries
 #include "../include/evaluationmetrics.h"
+using namespace evaluationmetrics;
 
 // Time measurements
 #define _VERBOSE_ON_
@@ -39,6 +40,20 @@ int main(int argc, char *argv[]) {
 		"{cuda    |       | Use CUDA or not (CUDA ON: 1, CUDA OFF: 0)}"         // Use CUDA (if available) (optional)
 		"{save    |       | Save measurements or not (ON: 1, OFF: 0)}"			// Save measurements (optional)
 		"{show    |       | Show result (ON: 1, OFF: 0)}"						// Show the measurements (optional)
+		"{batch   |0      | Evaluate a directory pair or a manifest (ON: 1, OFF: 0)}"	// Batch evaluation (optional)
+		"{workers |0      | Images evaluated in parallel in batch mode (all cores: 0)}"	// Batch evaluation (optional)
+		"{format  |csv    | Results file format in batch mode (csv or jsonl)}"		// Batch evaluation (optional)
+		"{resume  |0      | Skip the images already in the results file (ON: 1, OFF: 0)}"	// Batch evaluation (optional)
+		"{out     |       | Results file in batch mode}"							// Batch evaluation (optional)
+		"{cache   |       | Cache file of the metric values in batch mode}"			// Result cache (optional)
+		"{detector|SURF   | Feature detector (SURF, ORB, FAST, AKAZE or ALL to time them)}"	// Feature detector (optional)
+		"{grid    |1      | Features counted in a grid of n x n cells}"				// Feature detector (optional)
+		"{cellmax |0      | Maximum features counted in each cell (all: 0)}"		// Feature detector (optional)
+		"{video   |0      | Evaluate the frames of a processed video against the original (ON: 1, OFF: 0)}"	// Video evaluation (optional)
+		"{tile    |0      | Tile size of the sharpness, e.g. 512 (whole image: 0)}"	// Tiled sharpness (optional)
+		"{sharpmap|0      | Save the sharpness of every tile as an image (ON: 1, OFF: 0)}"	// Tiled sharpness (optional)
+		"{histimg |0      | Render the histograms as images besides their counts (ON: 1, OFF: 0)}"	// Histogram images (optional)
+		"{render  |0      | Only render the images of saved histogram counts (ON: 1, OFF: 0)}"	// Histogram images (optional)
 		"{help h usage ?  |       | Print help message}";						// Show help (optional)
 
 	CommandLineParser cvParser(argc, argv, keys);
@@ -57,6 +72,20 @@ int main(int argc, char *argv[]) {
 		std::cout << "\t*-cuda=0 or -cuda=1 (ON: 1, OFF: 0)" << endl;
 		std::cout << "\t*-save=0 or -save=1 (ON: 1, OFF: 0)" << endl;
 		std::cout << "\t*-show=0 or -show=1 (ON: 1, OFF: 0)" << endl;
+		std::cout << "\t*-batch=0 or -batch=1 Processed and Original are directories or Processed is a manifest file (ON: 1, OFF: 0)" << endl;
+		std::cout << "\t*-workers=<n> Images evaluated in parallel in batch mode (default: all cores)" << endl;
+		std::cout << "\t*-format=csv or -format=jsonl Format of the results file in batch mode (default: csv)" << endl;
+		std::cout << "\t*-resume=0 or -resume=1 Skips the images already in the results file (ON: 1, OFF: 0)" << endl;
+		std::cout << "\t*-out=<file> Results file in batch mode (default: evaluation_metrics.csv next to the processed images)" << endl;
+		std::cout << "\t*-cache=<file> Reuses the metric values of unchanged images in batch mode (OFF: no file)" << endl;
+		std::cout << "\t*-detector=SURF, ORB, FAST or AKAZE Detector of the features metric, ALL times each one (default: SURF)" << endl;
+		std::cout << "\t*-grid=<n> Counts the features in a grid of n x n cells (default: 1)" << endl;
+		std::cout << "\t*-cellmax=<k> Keeps the k strongest features of each cell (all: 0)" << endl;
+		std::cout << "\t*-video=0 or -video=1 Processed and Original are videos evaluated frame by frame (ON: 1, OFF: 0)" << endl;
+		std::cout << "\t*-tile=<n> Computes the sharpness in tiles of n x n pixels, e.g. 512 (whole image: 0)" << endl;
+		std::cout << "\t*-sharpmap=0 or -sharpmap=1 Saves the sharpness of every tile in '<processed>_sharpness.png' (ON: 1, OFF: 0)" << endl;
+		std::cout << "\t*-histimg=0 or -histimg=1 Saves the histograms as '_hist.jpg' images besides their counts in '_hist.csv' (ON: 1, OFF: 0)" << endl;
+		std::cout << "\t*-render=0 or -render=1 Processed is a '_hist.csv' file or a directory of them, only their images are saved (ON: 1, OFF: 0)" << endl;
 		std::cout << "\t*Argument 'm=<metrics>' is a string containing a list of the desired metrics to be calculated" << endl;
 		std::cout << endl << "Complete options of evaluation metrics are:" << endl;
 		std::cout << "\t-m=E for Entropy" << endl;
@@ -67,19 +96,32 @@ int main(int argc, char *argv[]) {
 		std::cout << "\t-m=F for Comprehensive Assessment Function" << endl;
 		std::cout << "\t-m=M for Mean Square Error" << endl;
 		std::cout << "\t-m=P for Peak Signal to Noise Ratio" << endl;
+		std::cout << "\t-m=Y for Structural Similarity (SSIM)" << endl;
 		std::cout << "\t-m=S for Frequency Domain Image Sharpness Measure" << endl;
-		std::cout << "\t-m=U for Feature detection using SURF" << endl;
+		std::cout << "\t-m=U for Feature detection (SURF, ORB, FAST or AKAZE)" << endl;
+		std::cout << "\t-m=Q for Underwater Color Image Quality Evaluation (UCIQE)" << endl;
+		std::cout << "\t-m=I for Underwater Image Quality Measure (UIQM)" << endl;
 		std::cout << "\t-m=H for Histogram" << endl;
 		std::cout << "\t-m=X for All Metrics" << endl;
 		std::cout << endl << "Example:" << endl;
 		std::cout << "\tproc.jpg orig.jpg -cuda=0 -save=1 -show=0 -m=EM" << endl;
-		std::cout << "\tThis will open 'proc.jpg' and 'orig.jpg' and calculate the Entropy and the MSE and save the results in a csv file" << endl << endl;
+		std::cout << "\tThis will open 'proc.jpg' and 'orig.jpg' and calculate the Entropy and the MSE and save the results in a csv file" << endl;
+		std::cout << "\tproc/ orig/ -batch=1 -workers=8 -resume=1 -m=X" << endl;
+		std::cout << "\tThis will calculate all the metrics of the images in 'proc' using the images with the same name in 'orig'" << endl;
+		std::cout << "\tproc/ proc/ -render=1 -show=0" << endl;
+		std::cout << "\tThis will save the images of the histograms saved in 'proc' by a previous evaluation" << endl << endl;
 		return 0;
 	}
 
 	int CUDA = 0;											// Default option (running with CPU)
 	int Save = 0;											// Default option (not saving results)
 	int Show = 0;											// Default option (not showing results)
+	int Batch = 0;											// Default option (one image pair)
+	int Workers = 0;										// Default option (one worker per core)
+	int Resume = 0;											// Default option (evaluating every image)
+	int Video = 0;											// Default option (images)
+	int Render = 0;											// Default option (evaluating the images)
+	metricParams Params;									// Default option (SURF on the whole image)
 
 	std::string ProcessedFile = cvParser.get<cv::String>(0);// String containing the input file path+name+extension from cvParser function
 	std::string OriginalFile = cvParser.get<cv::String>(1); // String containing the input file path+name+extension from cvParser function
@@ -87,12 +129,30 @@ int main(int argc, char *argv[]) {
 	std::string implementation;								// CPU or GPU implementation
 	Show = cvParser.get<int>("show");						// Gets argument -show=x, where 'x' defines if the results will be shown or not
 	Save = cvParser.get<int>("save");						// Gets argument -save=x, where 'x' defines if the results will be saves
+	Batch = cvParser.get<int>("batch");						// Gets argument -batch=x, where 'x' defines if a dataset is evaluated
+	Workers = cvParser.get<int>("workers");					// Gets argument -workers=x, where 'x' is the number of parallel evaluations
+	Resume = cvParser.get<int>("resume");					// Gets argument -resume=x, where 'x' defines if evaluated images are skipped
+	Video = cvParser.get<int>("video");						// Gets argument -video=x, where 'x' defines if the inputs are videos
+	Render = cvParser.get<int>("render");					// Gets argument -render=x, where 'x' defines if only the histogram images are saved
+	std::string Format = cvParser.get<cv::String>("format");	// Gets argument -format=x, where 'x' is the format of the results file
+	std::string Detector = cvParser.get<cv::String>("detector");	// Gets argument -detector=x, where 'x' is the feature detector
+	Params.grid = std::max(1, cvParser.get<int>("grid"));	// Gets argument -grid=x, where 'x' is the number of cells in each direction
+	Params.cellMax = cvParser.get<int>("cellmax");			// Gets argument -cellmax=x, where 'x' is the maximum of features of each cell
+	Params.detector = featureDetector(Detector == "ALL" ? "SURF" : Detector);	// Detector actually used
+	Params.tile = cvParser.get<int>("tile");				// Gets argument -tile=x, where 'x' is the tile size of the sharpness
+	Params.sharpnessMap = Params.tile > 0 && cvParser.get<int>("sharpmap") != 0;	// Gets argument -sharpmap=x, where 'x' defines if the tile map is saved
+	Params.histogramImages = cvParser.get<int>("histimg") != 0;	// Gets argument -histimg=x, where 'x' defines if the histogram images are saved
 
 	// Check if any error occurred during parsing process
 	if (!cvParser.check()) {
 		cvParser.printErrors();
 		return -1;
 	}
+	if (Params.detector.empty()) {
+		std::cout << "Detector " << Detector << " not recognized, use SURF, ORB, FAST, AKAZE or ALL" << endl << endl;
+		return -1;
+	}
+	if (Detector != "ALL" && Params.detector != Detector) std::cout << Detector << " is not available, using " << Params.detector << endl;
 
 	//************************************************************************************************
 	int nCuda = -1;    // Defines number of detected CUDA devices. By default, -1 acting as error value
@@ -121,6 +181,106 @@ int main(int argc, char *argv[]) {
 #endif
 	//************************************************************************************************
 
+	// Images of the histogram counts saved by a previous evaluation, apart from the evaluation itself
+	if (Render) {
+		std::vector<cv::String> files;
+		if (ProcessedFile.size() > 9 && ProcessedFile.compare(ProcessedFile.size() - 9, 9, "_hist.csv") == 0) files.push_back(ProcessedFile);
+		else cv::glob(ProcessedFile + "/*_hist.csv", files, false);
+		int rendered = 0;
+		t = (double)getTickCount();
+		for (size_t i = 0; i < files.size(); i++) {
+			qualityMetrics r;
+			std::string image = std::string(files[i]).substr(0, files[i].size() - 4) + ".jpg";
+			if (!loadHistograms(files[i], r)) {
+				std::cout << "Error occured when loading " << files[i] << endl;
+				continue;
+			}
+			if (cv::imwrite(image, histogramImage(r))) rendered++;
+		}
+		t = 1000 * ((double)getTickCount() - t) / getTickFrequency();
+		std::cout << endl << "Histogram images saved: " << rendered << " of " << files.size() << " in " << t << " ms" << endl << endl;
+		return 0;
+	}
+
+	// Batch evaluation of a dataset with a pool of workers and a single results file
+	if (Batch) {
+		std::vector<imagePair> pairs = listPairs(ProcessedFile, OriginalFile);
+		std::size_t pos = ProcessedFile.find_last_of("/\\");
+		bool manifest = ProcessedFile.find_last_of('.') != std::string::npos && (pos == std::string::npos || ProcessedFile.find_last_of('.') > pos);
+		std::string Results = manifest ? ProcessedFile.substr(0, pos == std::string::npos ? 0 : pos + 1) : ProcessedFile + "/";
+		Results += Format == "jsonl" ? "evaluation_metrics.jsonl" : "evaluation_metrics.csv";
+		if (cvParser.has("out")) Results = cvParser.get<cv::String>("out");
+		std::cout << endl << "Evaluating " << pairs.size() << " image pairs" << endl;
+
+		resultSink sink(Results, Format == "jsonl", Resume != 0);
+		if (!sink.isOpen()) {
+			std::cout << "Error occured when opening " << Results << endl << endl;
+			return -1;
+		}
+		metricCache *cache = NULL;
+		if (cvParser.has("cache")) {									// Values of previous runs
+			cache = new metricCache(cvParser.get<cv::String>("cache"));
+			if (!cache->isOpen()) {
+				std::cout << "Error occured when opening " << cvParser.get<cv::String>("cache") << endl << endl;
+				return -1;
+			}
+		}
+		int skipped = 0, failed = 0;
+		t = (double)getTickCount();
+		int evaluated = evaluateBatch(pairs, metric, Params, sink, cache, Workers > 0 ? Workers : getNumberOfCPUs(), &skipped, &failed);
+		t = 1000 * ((double)getTickCount() - t) / getTickFrequency();
+		std::cout << "Evaluated: " << evaluated << ", already evaluated: " << skipped << ", failed: " << failed << endl;
+		std::cout << "Execution Time: " << t << " ms (" << (evaluated > 0 ? t / evaluated : 0) << " ms per image)" << endl;
+		if (cache) {
+			int lookups = cache->hits() + cache->misses();
+			std::cout << "Cache hits: " << cache->hits() << " of " << lookups << " metric values (" << fixed << setprecision(1)
+				<< (lookups > 0 ? 100.0 * cache->hits() / lookups : 0) << " %)" << endl;
+			delete cache;
+		}
+		std::cout << endl << "Evaluation metrics saved in " << Results << endl;
+		return 0;
+	}
+
+	// Frame by frame evaluation of a video, decoding both videos in lockstep
+	if (Video) {
+		std::string Frames = ProcessedFile.substr(0, ProcessedFile.find_last_of('.')) + (Format == "jsonl" ? "_metrics.jsonl" : "_metrics.csv");
+		if (cvParser.has("out")) Frames = cvParser.get<cv::String>("out");
+		std::cout << endl << "Original Video: " << OriginalFile << endl;
+		std::cout << "Processed Video: " << ProcessedFile << endl;
+
+		std::vector<metricStats> summary;
+		int frames;
+		t = (double)getTickCount();
+		{
+			resultSink sink(Frames, Format == "jsonl", false);
+			frames = evaluateVideo(ProcessedFile, OriginalFile, metric, Params, sink, Workers > 0 ? Workers : getNumberOfCPUs(), &summary);
+		}
+		t = 1000 * ((double)getTickCount() - t) / getTickFrequency();
+		if (frames < 0) {
+			std::cout << "Error occured when opening the videos" << endl << endl;
+			return -1;
+		}
+
+		// Summary of every metric over the frames (mean, standard deviation, minimum and maximum)
+		std::cout << endl << "Frames evaluated: " << frames << " in " << t << " ms (" << (frames > 0 ? t / frames : 0) << " ms per frame)" << endl;
+		std::ostringstream row;
+		row << endl << ProcessedFile.substr(ProcessedFile.find_last_of("/\\") + 1) << ";" << fixed;
+		for (size_t i = 0; i < summary.size(); i++) {
+			std::cout << summary[i].key << ": " << fixed << setprecision(summary[i].precision + 1) << summary[i].mean << " (std " << summary[i].stddev
+				<< ", min " << summary[i].min << ", max " << summary[i].max << ")" << endl;
+			row << setprecision(summary[i].precision + 1) << summary[i].mean << ";";
+		}
+		if (Save) {
+			std::size_t sep = ProcessedFile.find_last_of("/\\");
+			std::string Output = ProcessedFile.substr(0, sep == std::string::npos ? 0 : sep + 1) + "evaluation_metrics.csv";
+			ofstream results(Output, std::ios::app);
+			results << row.str();
+			std::cout << endl << "Mean of the metrics saved in " << Output << endl;
+		}
+		std::cout << "Metrics of every frame saved in " << Frames << endl;
+		return 0;
+	}
+
 	std::cout << endl << "********************************************************************************" << endl;
 	std::cout << "Original Image: " << OriginalFile << endl;
 	std::cout << "Processed Image: " << ProcessedFile << endl;
@@ -389,215 +549,125 @@ int main(int argc, char *argv[]) {
 	// CPU Implementation
 	if (!CUDA) {
 
-		cv::Mat graysrc, graydst, chanLAB[3], src_LAB, hist_RGB[3], hist_LAB[3], RGB_hist[3], LAB_hist[3], histRGB, histLAB, hist, descriptor;
-		std::vector<Mat> chanRGB;
-		float entropy_src, AE_src = 0, AC_src = 0, AL_src = 0, NNF_src = 0, CAF_src, IQM_src, MSE = 0, psnr = 0;
-		int minHessian = 400;
-		cv::Ptr<Feature2D> detector;
-		std::vector<KeyPoint> keypoint;
-		std::size_t pos = ProcessedFile.find(".");
+		cv::Mat hist;
+		std::size_t sep = ProcessedFile.find_last_of("/\\"), pos = ProcessedFile.find_last_of('.');
+		if (pos == std::string::npos || (sep != std::string::npos && pos < sep)) pos = ProcessedFile.size();	// Extension of the file name only
 		std::string Histograms = ProcessedFile.substr(0, pos) + "_hist.jpg";
-		Scalar colorA, colorB;
-
-		// Now, according to parameters provided at CLI calling time
-		file.open(Output, std::ios::app);	// Open the csv file in append mode
-		file << endl << Name << ";";		// Adds endl to start adding information in the next line
-		file.close();
+		std::string Counts = ProcessedFile.substr(0, pos) + "_hist.csv";
+
+		// The requested metrics are computed in a single pass sharing their intermediates
+		metric = planMetrics(metric, OriginalFile.compare(ProcessedFile) != 0);
+		qualityMetrics r = evaluateMetrics(src, dst, metric, Params);
+
+		// Comparison of the feature detectors
+		if (Detector == "ALL" && metric.find('U') != std::string::npos) {
+			const char *detectors[] = { "SURF", "ORB", "FAST", "AKAZE" };
+			cv::Mat gray;
+			cvtColor(src, gray, COLOR_BGR2GRAY);
+			std::cout << "Feature detectors:" << endl;
+			for (int d = 0; d < 4; d++) {
+				metricParams p = Params;
+				p.detector = featureDetector(detectors[d]);
+				if (p.detector != detectors[d]) {
+					std::cout << "\t" << detectors[d] << ": not available" << endl;
+					continue;
+				}
+				double td = (double)getTickCount();
+				int count = countFeatures(gray, p);
+				td = 1000 * ((double)getTickCount() - td) / getTickFrequency();
+				std::cout << "\t" << detectors[d] << ": " << count << " features in " << fixed << setprecision(1) << td << " ms" << endl;
+			}
+		}
 
-		for (int nm = 0; nm <= num_metrics; nm++) {
+		for (size_t nm = 0; nm < metric.length(); nm++) {
 			char M = metric[nm];
 
 			switch (M) {
 
 				case 'E':	// Entropy
-					if (graysrc.empty()) cvtColor(src, graysrc, COLOR_BGR2GRAY);
-					entropy_src = entropy(graysrc);
-					if (Show) std::cout << "Grayscale Entropy: " << fixed << setprecision(3) << entropy_src << endl;
-					if (Save) {
-						file.open(Output, std::ios::app);
-						file << fixed << setprecision(3) << entropy_src << ";";
-					}
+					if (Show) std::cout << "Grayscale Entropy: " << fixed << setprecision(3) << r.entropy << endl;
 				break;
 
 				case 'A':	// Average Entropy
-					if (chanRGB.empty()) split(src, chanRGB);
-					AE_src = averageEntropy(chanRGB);
-					if (Show) std::cout << "Average Color Entropy: " << fixed << setprecision(3) << AE_src << endl;
-					if (Save) {
-						file.open(Output, std::ios::app);
-						file << fixed << setprecision(3) << AE_src << ";";
-					}
+					if (Show) std::cout << "Average Color Entropy: " << fixed << setprecision(3) << r.AE << endl;
 				break;
 
 				case 'C':	//  Average Contrast
-					if (chanRGB.empty()) split(src, chanRGB);
-					AC_src = averageContrast(chanRGB);
-					if (Show) std::cout << "Average Contrast: " << fixed << setprecision(3) << AC_src << endl;
-					if (Save) {
-						file.open(Output, std::ios::app);
-						file << fixed << setprecision(3) << AC_src << ";";
-					}
+					if (Show) std::cout << "Average Contrast: " << fixed << setprecision(3) << r.AC << endl;
 				break;
 
 				case 'L':	// Average Luminance
-					if (src_LAB.empty()) {
-						cvtColor(src, src_LAB, COLOR_BGR2Lab);
-						split(src_LAB, chanLAB);
-					}
-					AL_src = averageLuminance(chanLAB[0]);
-					if (Show) std::cout << "Average Luminance: " << fixed << setprecision(3) << AL_src << endl;
-					if (Save) {
-						file.open(Output, std::ios::app);
-						file << fixed << setprecision(3) << AL_src << ";";
-					}
+					if (Show) std::cout << "Average Luminance: " << fixed << setprecision(3) << r.AL << endl;
 				break;
 
 				case 'N':	// Normalized Neighborhood Function
-					if (!AL_src) {
-						if (src_LAB.empty()) {
-							cvtColor(src, src_LAB, COLOR_BGR2Lab);
-							split(src_LAB, chanLAB);
-						}
-						AL_src = averageLuminance(chanLAB[0]);
-					}
-					NNF_src = getNNF(AL_src);
-					if (Show) std::cout << "Normalized Neighborhood Function: " << fixed << setprecision(5) << NNF_src << endl;
-					if (Save) {
-						file.open(Output, std::ios::app);
-						file << fixed << setprecision(5) << NNF_src << ";";
-					}
+					if (Show) std::cout << "Normalized Neighborhood Function: " << fixed << setprecision(5) << r.NNF << endl;
 				break;
 
 				case 'F':	// Comprehensive Assesment Function
-					if (!AE_src) {
-						split(src, chanRGB);
-						AE_src = averageEntropy(chanRGB);
-					}
-					if (!AC_src) {
-						split(src, chanRGB);
-						AC_src = averageContrast(chanRGB);
-					}
-					if (!NNF_src) {
-						if (!AL_src) {
-							if (src_LAB.empty()) {
-								cvtColor(src, src_LAB, COLOR_BGR2Lab);
-								split(src_LAB, chanLAB);
-							}
-							AL_src = averageLuminance(chanLAB[0]);
-						}
-						NNF_src = getNNF(AL_src);
-					}
-					CAF_src = getCAF(AE_src, AC_src, NNF_src);
-					if (Show) std::cout << "Comprehensive Assessment Function: " << fixed << setprecision(3) << CAF_src << endl;
-					if (Save) {
-						file.open(Output, std::ios::app);
-						file << fixed << setprecision(3) << CAF_src << ";";
-					}
+					if (Show) std::cout << "Comprehensive Assessment Function: " << fixed << setprecision(3) << r.CAF << endl;
 				break;
 
 				case 'S':	// Image Sharpness in Frequency Domain
-					if (graysrc.empty()) cvtColor(src, graysrc, COLOR_BGR2GRAY);
-					IQM_src = sharpness(graysrc);
-					if (Show) std::cout << "Image Sharpness: " << fixed << setprecision(5) << IQM_src << endl;
-					if (Save) {
-						file.open(Output, std::ios::app);
-						file << fixed << setprecision(5) << IQM_src << ";";
+					if (Show) std::cout << "Image Sharpness: " << fixed << setprecision(5) << r.IQM << endl;
+					if (Save && !r.sharpnessMap.empty()) {
+						cv::imwrite(ProcessedFile.substr(0, pos) + "_sharpness.png", sharpnessImage(r.sharpnessMap, src.size()));
+						std::cout << "Sharpness map saved" << endl;
 					}
 				break;
 
-				case 'U':	// Feature detection using SURF
-					if (graysrc.empty()) cvtColor(src, graysrc, COLOR_BGR2GRAY);
-					detector = SURF::create(minHessian);
-					detector->detectAndCompute(graysrc, Mat(), keypoint, descriptor);
-					if (Show) std::cout << "Features Detected: " << keypoint.size() << endl;
-					if (Save) {
-						file.open(Output, std::ios::app);
-						file << keypoint.size() << ";";
-					}
+				case 'U':	// Feature detection
+					if (Show) std::cout << "Features Detected (" << Params.detector << "): " << r.features << endl;
 				break;
 
 				case 'M':	// Mean Square Error
-					if (graysrc.empty()) cvtColor(src, graysrc, COLOR_BGR2GRAY);
-					if (graydst.empty()) cvtColor(dst, graydst, COLOR_BGR2GRAY);
-					MSE = getMSE(graysrc, graydst);
-					if (Show) std::cout << fixed << setprecision(3) << "MSE: " << MSE << endl;
-					if (Save) {
-						file.open(Output, std::ios::app);
-						file << int(MSE) << ";";
-					}
-					break;
+					if (Show) std::cout << fixed << setprecision(3) << "MSE: " << r.MSE << " (B: " << r.channels.MSE[0] << ", G: "
+						<< r.channels.MSE[1] << ", R: " << r.channels.MSE[2] << ")" << endl;
+				break;
 
 				case 'P':	// Peak Signal to Noise Ratio
-					if (!MSE) {
-						if (graysrc.empty()) cvtColor(src, graysrc, COLOR_BGR2GRAY);
-						if (graydst.empty()) cvtColor(dst, graydst, COLOR_BGR2GRAY);
-						MSE = getMSE(graysrc, graydst);
-					}
-					psnr = getPSNR(MSE);
-					if (Show) std::cout << "PSNR: " << fixed << setprecision(3) << psnr << endl;
-					if (Save) {
-						file.open(Output, std::ios::app);
-						file << fixed << setprecision(3) << psnr << ";";
-					}
-					break;
+					if (Show) std::cout << "PSNR: " << fixed << setprecision(3) << r.PSNR << " (B: " << r.channels.PSNR[0] << ", G: "
+						<< r.channels.PSNR[1] << ", R: " << r.channels.PSNR[2] << ")" << endl;
+				break;
 
-				case 'H':	// Histogram
-					if (chanRGB.empty()) split(src, chanRGB);
-					if (chanLAB->empty()) {
-						cvtColor(src, src_LAB, COLOR_BGR2Lab);
-						split(src_LAB, chanLAB);
-					}
+				case 'Y':	// Structural Similarity
+					if (Show) std::cout << "SSIM: " << fixed << setprecision(5) << r.SSIM << " (B: " << r.channels.SSIM[0] << ", G: "
+						<< r.channels.SSIM[1] << ", R: " << r.channels.SSIM[2] << ")" << endl;
+				break;
 
-					// RGB histogram
-					getHistogram(&chanRGB[0], &hist_RGB[0]);
-					RGB_hist[0] = printHist(hist_RGB[0], { 255,0,0 });
-					getHistogram(&chanRGB[1], &hist_RGB[1]);
-					RGB_hist[1] = printHist(hist_RGB[1], { 0,255,0 });
-					getHistogram(&chanRGB[2], &hist_RGB[2]);
-					RGB_hist[2] = printHist(hist_RGB[2], { 0,0,255 });
-					cv::vconcat(RGB_hist[0], RGB_hist[1], histRGB);
-					cv::vconcat(histRGB, RGB_hist[2], histRGB);
-
-					// LAB histogram
-					getHistogram(&chanLAB[0], &hist_LAB[0]);
-					LAB_hist[0] = printHist(hist_LAB[0], { 0,0,0 });
-					getHistogram(&chanLAB[1], &hist_LAB[1]);
-					if (mean(chanLAB[1])[0] > 127.5) colorA = { 150,15,235 };
-					else colorA = { 75,155,10 };
-					LAB_hist[1] = printHist(hist_LAB[1], colorA);
-					getHistogram(&chanLAB[2], &hist_LAB[2]);
-					if (mean(chanLAB[2])[0] > 127.5) colorB = { 7,217,254 };
-					else colorB = { 240,210,40 };
-					LAB_hist[2] = printHist(hist_LAB[2], colorB);
-					cv::vconcat(LAB_hist[0], LAB_hist[1], histLAB);
-					cv::vconcat(histLAB, LAB_hist[2], histLAB);
-
-					// Histogram comparison
-					cv::hconcat(histRGB, histLAB, hist);
+				case 'Q':	// Underwater Color Image Quality Evaluation
+					if (Show) std::cout << "UCIQE: " << fixed << setprecision(5) << r.UCIQE << endl;
+				break;
 
+				case 'I':	// Underwater Image Quality Measure
+					if (Show) std::cout << "UIQM: " << fixed << setprecision(5) << r.UIQM << " (UICM: " << r.UICM << ", UISM: " << r.UISM
+						<< ", UIConM: " << r.UIConM << ")" << endl;
+				break;
+
+				case 'H':	// Histogram
+					if (Show || Params.histogramImages) hist = histogramImage(r);		// RGB and CIELab histograms side by side
 					if (Show & !Save) {
 						std::cout << "Showing histograms" << endl;
 						namedWindow("Histograms", WINDOW_KEEPRATIO);
 						imshow("Histograms", hist);
 					}
 					if (Save) {
-						cv::imwrite(Histograms, hist);
+						saveHistograms(Counts, r);
+						if (Params.histogramImages) cv::imwrite(Histograms, hist);
 						std::cout << "Histograms saved" << endl << endl;
 					}
 				break;
 
-				case 'X':	// All Metrics
-					if (OriginalFile.compare(ProcessedFile) == 0) metric = "EACLNFSUH";
-					else metric = "EACLNFSUMPH";
-					num_metrics = metric.length();
-					nm--;
-				break;
-
 				default:	// Unrecognized option
 					std::cout << "Option " << M << " not recognized, skipping..." << endl << endl;
 				break;
 			}
+		}
 
+		// Now, according to parameters provided at CLI calling time
+		if (Save) {
+			file.open(Output, std::ios::app);	// Open the csv file in append mode
+			file << metricsRow(Name, r, false);	// Adds endl to start adding information in the next line
 			file.close();
 		}
 	}
@@ -15,6 +15,12 @@
 
 #define ABOUT_STRING "Fusion Enhancement Module"
 
+#define THUMBNAIL_SIZE 512		// Largest side of the strided sample used to classify the input
+#define SAMPLE_SIZE 1024		// Largest side of the sample used to estimate the global parameters of the tiled fusion
+#define PYRAMID_LEVELS 5		// Levels of the pyramids used in the multiscale fusion
+#define BYTES_PER_PIXEL 200		// Approximate memory used by the fusion of one pixel (inputs, weight maps and pyramids)
+#define MIN_TILE 256			// Smallest side of a tile before reducing the number of workers
+
 ///Basic C and C++ libraries
 #include <iostream>
 #include <iomanip>
@@ -41,6 +47,95 @@ using namespace ximgproc;
 #include "opencv2/cudaarithm.hpp"
 #endif
 
+// Functions of the module, built as fusion_lib and also linked by the benchmark module
+namespace fusion {
+
+/*
+	@brief		Decision statistics of the input image and the enhancement selected for each input of the fusion
+*/
+struct fusionClass {
+	int input1;					// First input: 0 ICM, 1 Hue and Illumination Correction
+	int input2;					// Second input: 0 Dehazing, 1 Hue and Illumination Correction, 2 None (the first input is the result)
+	double meanS, stddevS;		// Saturation channel statistics (HSV)
+	double meanV, stddevV;		// Value channel statistics (HSV)
+	double meanU, meanv;		// Mean of the chromatic components u and v (CIELuv)
+};
+
+/*
+	@brief		Classifies the input image using a strided sample to select the enhancement of each input of the fusion
+	@function	fusionClass classifyInput(cv::Mat src, int size)
+*/
+fusionClass classifyInput(cv::Mat src, int size);
+
+/*
+	@brief		Global parameters of the Integrated Color Model (stretching limits of the BGR, S and V channels)
+*/
+struct icmParams {
+	float chan_min[3], chan_max[3];		// Limits of the Blue, Green and Red channels
+	float hsv_min[3], hsv_max[3];		// Limits of the HSV channels (only S and V are used)
+};
+
+/*
+	@brief		Global parameters of the hue and illumination correction
+*/
+struct illuminationParams {
+	double Lmin, Lmax;					// Range of the luminance channel
+	double outMin, outMax;				// Range of the luminance after the homomorphic filter
+	double meanA, meanB;				// Mean of the chromatic components (Grey World Assumption)
+	cv::Mat lowFreq;					// Low frequency component removed by the homomorphic filter (logarithm, sample size)
+};
+
+/*
+	@brief		Global parameters of the dehazing using the Bright Channel Prior
+*/
+struct dehazeParams {
+	int size;							// Size of the bright channel filter
+	int order[3];						// Channels sorted by their mean from low to high
+	double lambda;						// Weight of the bright channel in the rectification
+	vector<uchar> A;					// Atmospheric light
+};
+
+/*
+	@brief		Global parameters of the tiled fusion, estimated once for the whole image
+*/
+struct fusionParams {
+	fusionClass inputs;
+	icmParams icm;
+	illuminationParams illum;
+	dehazeParams dehaze;
+	Scalar saliency[2];					// Mean of the blurred inputs in CIELAB
+};
+
+/*
+	@brief		Estimates the global parameters of the tiled fusion using a sample of the image
+	@function	fusionParams fusionParameters(cv::Mat src, fusionClass inputs)
+*/
+fusionParams fusionParameters(cv::Mat src, fusionClass inputs);
+
+/*
+	@brief		Enhances and fuses one tile of the image using the global parameters
+	@function	cv::Mat fusionTile(cv::Mat src, fusionParams p, cv::Rect roi, cv::Size size)
+*/
+cv::Mat fusionTile(cv::Mat src, fusionParams p, cv::Rect roi, cv::Size size);
+
+/*
+	@brief		Fuses the image by tiles with a pyramid depth aware overlap, limiting the working memory to budget MB
+	@function	cv::Mat fusionTiled(cv::Mat src, fusionClass inputs, int budget, int *workers, int *tiles)
+*/
+cv::Mat fusionTiled(cv::Mat src, fusionClass inputs, int budget, int *workers, int *tiles);
+
+/*
+	@brief		Enhances the two inputs selected by the classification and fuses them (whole image on the CPU)
+	@function	cv::Mat fusionEnhance(cv::Mat src, fusionClass inputs)
+*/
+cv::Mat fusionEnhance(cv::Mat src, fusionClass inputs);
+
+/*
+	@brief		Fuses two enhanced inputs using their weight maps and a multiscale approach
+	@function	cv::Mat fuseInputs(cv::Mat src[2], const Scalar *means)
+*/
+cv::Mat fuseInputs(cv::Mat src[2], const Scalar *means);
+
 /*
 	@brief		Corrects ununinform illumination using a homomorphic filter
 	@function	illuminationCorrection(cv::Mat src)
@@ -69,6 +164,36 @@ void getHistogram(cv::Mat *channel, cv::Mat *hist);
 
 cv::Mat histStretch(cv::Mat src, float percent, int direction);
 
+/*
+	@brief		Finds the limits of the histogram stretching leaving out a percent of the pixels in each side
+	@function	void stretchLimits(cv::Mat src, float percent, float &channel_min, float &channel_max)
+*/
+void stretchLimits(cv::Mat src, float percent, float &channel_min, float &channel_max);
+
+/*
+	@brief		Stretches one image channel between the given limits in a specific direction (right 0, both sides 1 or left 2)
+	@function	cv::Mat stretch(cv::Mat src, float channel_min, float channel_max, int direction)
+*/
+cv::Mat stretch(cv::Mat src, float channel_min, float channel_max, int direction);
+
+/*
+	@brief		Estimates the global parameters of the hue and illumination correction
+	@function	illuminationParams illuminationParameters(cv::Mat src)
+*/
+illuminationParams illuminationParameters(cv::Mat src);
+
+/*
+	@brief		Corrects ununinform illumination of a tile using the global parameters
+	@function	cv::Mat illuminationCorrection(cv::Mat src, illuminationParams p, cv::Rect roi, cv::Size size)
+*/
+cv::Mat illuminationCorrection(cv::Mat src, illuminationParams p, cv::Rect roi, cv::Size size);
+
+/*
+	@brief		Corrects the hue shift and ununiform illumination of a tile using the global parameters
+	@function	cv::Mat hueIllumination(cv::Mat src, illuminationParams p, cv::Rect roi, cv::Size size)
+*/
+cv::Mat hueIllumination(cv::Mat src, illuminationParams p, cv::Rect roi, cv::Size size);
+
 /*
 	@brief		Corrects the hue shift and ununiform illumination of the underwater image
 	@function	cv::Mat hueIllumination(cv::Mat src)
@@ -81,12 +206,36 @@ cv::Mat hueIllumination(cv::Mat src);
 */
 cv::Mat ICM(vector<Mat_<uchar>> channel, float percent);
 
+/*
+	@brief		Estimates the stretching limits of the Integrated Color Model
+	@function	icmParams ICMParameters(vector<Mat_<uchar>> channel, float percent)
+*/
+icmParams ICMParameters(vector<Mat_<uchar>> channel, float percent);
+
+/*
+	@brief		Enhances the contrast of the image using the given stretching limits
+	@function	cv::Mat ICM(vector<Mat_<uchar>> channel, icmParams p)
+*/
+cv::Mat ICM(vector<Mat_<uchar>> channel, icmParams p);
+
 /*
 	@brief		Dehazes an underwater image using the Bright channel Prior
 	@function	cv::Mat dehazing(cv::Mat src)
 */
 cv::Mat dehazing(cv::Mat src);
 
+/*
+	@brief		Estimates the atmospheric light, rectification weight and channel order of an underwater image
+	@function	dehazeParams dehazingParameters(cv::Mat src)
+*/
+dehazeParams dehazingParameters(cv::Mat src);
+
+/*
+	@brief		Dehazes an underwater image using the given parameters
+	@function	cv::Mat dehazing(cv::Mat src, dehazeParams p)
+*/
+cv::Mat dehazing(cv::Mat src, dehazeParams p);
+
 /*
 	@brief		Generates the Bright Channel Image of an underwater image
 	@function	cv::Mat brightChannel(vector<Mat_<uchar>> channels, int size)
@@ -99,6 +248,12 @@ cv::Mat brightChannel(vector<Mat_<uchar>> channels, int size);
 */
 cv::Mat maxColDiff(vector<Mat_<uchar>> channels);
 
+/*
+	@brief		Generates the Maximum Color Difference Image using a given order of the channels
+	@function	cv::Mat maxColDiff(vector<Mat_<uchar>> channels, const int order[3])
+*/
+cv::Mat maxColDiff(vector<Mat_<uchar>> channels, const int order[3]);
+
 /*
 	@brief		Rectifies the Bright Channel Image
 	@function	cv::Mat  rectify(cv::Mat S, cv::Mat bc, cv::Mat mcd)
@@ -147,6 +302,18 @@ cv::Mat local_contrast(cv::Mat img, cv::Mat kernel);
 */
 cv::Mat saliency(cv::Mat img, cv::Mat kernel);
 
+/*
+	@brief		Computes a saliency weight map using the given mean of the image in CIELAB
+	@function	cv::Mat saliency(cv::Mat img, cv::Mat kernel, Scalar means)
+*/
+cv::Mat saliency(cv::Mat img, cv::Mat kernel, Scalar means);
+
+/*
+	@brief		Computes the mean of the blurred image in CIELAB used by the saliency weight map
+	@function	Scalar saliencyMeans(cv::Mat img, cv::Mat kernel)
+*/
+Scalar saliencyMeans(cv::Mat img, cv::Mat kernel);
+
 /*
 	@brief		Computes a exposedness weight map
 	@function	cv::Mat exposedness(cv::Mat img)
@@ -195,4 +362,6 @@ Mat pyramid_fusion(Mat *pyramid, int levels);
 	cv::cuda::GpuMat transmittance_GPU(cv::cuda::GpuMat correct, std::vector<uchar> A);
 
 	cv::cuda::GpuMat dehaze_GPU(std::vector<cv::cuda::GpuMat> channels, std::vector<uchar> A, cv::cuda::GpuMat trans);
-#endif
\ No newline at end of file
+#endif
+
+}	// namespace fusion
\ No newline at end of file
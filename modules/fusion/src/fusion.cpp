@@ -16,6 +16,220 @@
 /// Include auxiliary utility libraries
 #include "../include/fusion.h"
 
+namespace fusion {
+
+fusionClass classifyInput(cv::Mat src, int size) {											// Selects the enhancement of each input
+	cv::Mat sample = src;
+	double scale = (double)size / std::max(src.rows, src.cols);
+	if (size > 0 && scale < 1.0) resize(src, sample, Size(), scale, scale, INTER_NEAREST);	// Strided sampling keeps the distribution of the pixels
+
+	cv::Mat HSV, LUV, chanHSV[3], chanLUV[3];
+	cvtColor(sample, HSV, COLOR_BGR2HSV);
+	split(HSV, chanHSV);
+	cvtColor(sample, LUV, COLOR_BGR2Luv);
+	split(LUV, chanLUV);
+	Scalar meanS, stddevS, meanV, stddevV;
+	meanStdDev(chanHSV[1], meanS, stddevS);
+	meanStdDev(chanHSV[2], meanV, stddevV);
+
+	fusionClass c;
+	c.meanS = meanS[0], c.stddevS = stddevS[0];
+	c.meanV = meanV[0], c.stddevV = stddevV[0];
+	c.meanU = mean(chanLUV[1])[0], c.meanv = mean(chanLUV[2])[0];
+
+	// Histogram Stretching or Hue and Illumination Correction
+	if ((c.meanV <= 115 && (c.meanU <= 110 || c.meanv <= 110)) || (c.meanS >= 240 && c.stddevS <= 15)) c.input1 = 1;
+	else c.input1 = 0;
+
+	// Dehazing or Hue and Illumination Correction
+	if (c.stddevV >= 65 || (c.meanV >= 160 && (c.meanU <= 100 || c.meanv <= 100))) c.input2 = (c.input1 == 1) ? 2 : 1;
+	else c.input2 = 0;
+	return c;
+}
+
+fusionParams fusionParameters(cv::Mat src, fusionClass inputs) {							// Global parameters estimated once for the whole image
+	fusionParams p;
+	p.inputs = inputs;
+
+	cv::Mat sample = src, strided = src;
+	double scale = (double)SAMPLE_SIZE / std::max(src.rows, src.cols);
+	if (scale < 1.0) {
+		resize(src, sample, Size(), scale, scale, INTER_AREA);								// Averaged sample for the filters and the low frequencies
+		resize(src, strided, Size(), scale, scale, INTER_NEAREST);							// Strided sample keeps the distribution for the histograms
+	}
+
+	vector<Mat_<uchar>> channels;
+	split(strided, channels);
+	p.icm = ICMParameters(channels, 0.5);
+	p.illum = illuminationParameters(sample);
+	p.dehaze = dehazingParameters(sample);
+
+	// Enhance the sample to find the global means of the saliency weight maps
+	if (inputs.input2 != 2) {
+		cv::Mat input[2], kernel = filter_mask();
+		if (inputs.input1 == 1) input[0] = hueIllumination(sample, p.illum, Rect(0, 0, sample.cols, sample.rows), sample.size());
+		else input[0] = ICM(channels, p.icm);
+		if (inputs.input2 == 1) input[1] = hueIllumination(sample, p.illum, Rect(0, 0, sample.cols, sample.rows), sample.size());
+		else input[1] = dehazing(sample, p.dehaze);
+		p.saliency[0] = saliencyMeans(input[0], kernel);
+		p.saliency[1] = saliencyMeans(input[1], kernel);
+	}
+
+	p.dehaze.size = sqrt(src.total()) / 40;													// Filter size of the full resolution image
+	return p;
+}
+
+cv::Mat fusionTile(cv::Mat src, fusionParams p, cv::Rect roi, cv::Size size) {			// Enhances and fuses one tile
+	cv::Mat input[2];
+	vector<Mat_<uchar>> channels;
+	split(src, channels);
+
+	// Histogram Stretching or Hue and Illumination Correction
+	if (p.inputs.input1 == 1) input[0] = hueIllumination(src, p.illum, roi, size);
+	else input[0] = ICM(channels, p.icm);
+
+	// Dehazing or Hue and Illumination Correction
+	if (p.inputs.input2 == 2) return input[0];
+	else if (p.inputs.input2 == 1) input[1] = hueIllumination(src, p.illum, roi, size);
+	else input[1] = dehazing(src, p.dehaze);
+
+	return fuseInputs(input, p.saliency);
+}
+
+class fusionTiles : public ParallelLoopBody {												// Processes a range of tiles
+public:
+	fusionTiles(const cv::Mat &src, cv::Mat &dst, const fusionParams &p, int core, int margin)
+		: src(src), dst(dst), p(p), core(core), margin(margin) {
+		nx = (src.cols + core - 1) / core;
+	}
+
+	void operator()(const Range &range) const {
+		Rect image(0, 0, src.cols, src.rows);
+		for (int k = range.start; k < range.end; k++) {
+			Rect inner = Rect(k % nx * core, k / nx * core, core, core) & image;			// Region of the tile written in the result
+			Rect outer = Rect(inner.x - margin, inner.y - margin, inner.width + 2 * margin, inner.height + 2 * margin) & image;	// Region processed with the overlap
+			cv::Mat tile = fusionTile(src(outer), p, outer, src.size());
+			tile(Rect(inner.x - outer.x, inner.y - outer.y, inner.width, inner.height)).copyTo(dst(inner));
+		}
+	}
+
+private:
+	const cv::Mat &src;
+	cv::Mat &dst;
+	const fusionParams &p;
+	int core, margin, nx;
+};
+
+cv::Mat fusionTiled(cv::Mat src, fusionClass inputs, int budget, int *workers, int *tiles) {	// Tiled fusion for very large images
+	fusionParams p = fusionParameters(src, inputs);
+
+	// The overlap covers the support of the pyramids, the weight maps and the dehazing filters. It is aligned
+	// with the coarsest level of the pyramids so every tile shares the sampling grid of the whole image
+	int step = 1 << (PYRAMID_LEVELS - 1), margin = 0;
+	if (inputs.input2 != 2) margin += 4 * step + 2;
+	if (inputs.input2 == 0) margin += p.dehaze.size / 2 + 2 * 30 + 1;
+	margin = (margin + step - 1) / step * step;
+
+	// Largest aligned tile that fits in the memory budget of each worker, reducing the workers if the tiles get too small
+	double pixels = budget * 1024.0 * 1024.0 / BYTES_PER_PIXEL;
+	int n = getNumberOfCPUs(), core = 0;
+	for (; n > 1; n--) {
+		core = ((int)sqrt(pixels / n) - 2 * margin) / step * step;
+		if (core >= std::max(MIN_TILE, 2 * margin)) break;
+	}
+	if (n == 1) core = ((int)sqrt(pixels) - 2 * margin) / step * step;
+	if (core < 4 * step) core = 4 * step;
+
+	int nx = (src.cols + core - 1) / core, ny = (src.rows + core - 1) / core;
+	*workers = n;
+	*tiles = nx * ny;
+
+	cv::Mat dst(src.size(), CV_8UC3);
+	int threads = getNumThreads();
+	setNumThreads(n);
+	parallel_for_(Range(0, nx * ny), fusionTiles(src, dst, p, core, margin), nx * ny);
+	setNumThreads(threads);
+	return dst;
+}
+
+cv::Mat fusionEnhance(cv::Mat src, fusionClass inputs) {									// Enhances and fuses the whole image
+	cv::Mat enhanced[2];
+	vector<Mat_<uchar>> channels;
+	split(src, channels);
+
+	// Histogram Stretching or Hue and Illumination Correction
+	if (inputs.input1 == 1) enhanced[0] = hueIllumination(src);
+	else enhanced[0] = ICM(channels, 0.5);
+
+	// Dehazing or Hue and Illumination Correction
+	if (inputs.input2 == 2) return enhanced[0];
+	else if (inputs.input2 == 1) enhanced[1] = hueIllumination(src);
+	else enhanced[1] = dehazing(src);
+
+	// Multiscale fusion of the inputs
+	return fuseInputs(enhanced, NULL);
+}
+
+cv::Mat fuseInputs(cv::Mat src[2], const Scalar *means) {									// Multiscale fusion of two inputs
+	cv::Mat Lab[2], L[2];
+	cvtColor(src[0], Lab[0], COLOR_BGR2Lab);
+	extractChannel(Lab[0], L[0], 0);
+	cvtColor(src[1], Lab[1], COLOR_BGR2Lab);
+	extractChannel(Lab[1], L[1], 0);
+
+	cv::Mat kernel = filter_mask();
+
+	// Normalized weights
+	vector<Mat> w1_norm, w2_norm, w3_norm, w4_norm;
+	w1_norm = weight_norm(laplacian_contrast(L[0]), laplacian_contrast(L[1]));
+	w2_norm = weight_norm(local_contrast(L[0], kernel), local_contrast(L[1], kernel));
+	if (means) w3_norm = weight_norm(saliency(src[0], kernel, means[0]), saliency(src[1], kernel, means[1]));
+	else w3_norm = weight_norm(saliency(src[0], kernel), saliency(src[1], kernel));
+	w4_norm = weight_norm(exposedness(L[0]), exposedness(L[1]));
+
+	// Weight sum of each input
+	cv::Mat w_norm[2];
+	w_norm[0] = (w1_norm[0] + w2_norm[0] + w3_norm[0] + w4_norm[0]) / 4;
+	w_norm[1] = (w1_norm[1] + w2_norm[1] + w3_norm[1] + w4_norm[1]) / 4;
+
+	// Gaussian pyramids of the weights
+	int levels = PYRAMID_LEVELS;
+	vector<Mat> pyramid_g0, pyramid_g1;
+	buildPyramid(w_norm[0], pyramid_g0, levels - 1);
+	buildPyramid(w_norm[1], pyramid_g1, levels - 1);
+
+	cv::Mat channels_0[3], channels_1[3];
+	split(src[0], channels_0);
+	split(src[1], channels_1);
+
+	// Laplacian pyramids of the inputs channels (BGR)
+	vector<Mat_<float>> pyramid_l0_b = laplacian_pyramid(channels_0[0], levels);
+	vector<Mat_<float>> pyramid_l0_g = laplacian_pyramid(channels_0[1], levels);
+	vector<Mat_<float>> pyramid_l0_r = laplacian_pyramid(channels_0[2], levels);
+
+	vector<Mat_<float>> pyramid_l1_b = laplacian_pyramid(channels_1[0], levels);
+	vector<Mat_<float>> pyramid_l1_g = laplacian_pyramid(channels_1[1], levels);
+	vector<Mat_<float>> pyramid_l1_r = laplacian_pyramid(channels_1[2], levels);
+
+	// Fusion of the inputs with their respective weights
+	Mat chan_b[PYRAMID_LEVELS], chan_g[PYRAMID_LEVELS], chan_r[PYRAMID_LEVELS];
+	for (int i = 0; i < levels; i++) {
+		pyramid_g0[i].convertTo(pyramid_g0[i], CV_32F);
+		pyramid_g1[i].convertTo(pyramid_g1[i], CV_32F);
+		add(pyramid_l0_b[i].mul(pyramid_g0[i]), pyramid_l1_b[i].mul(pyramid_g1[i]), chan_b[i]);
+		add(pyramid_l0_g[i].mul(pyramid_g0[i]), pyramid_l1_g[i].mul(pyramid_g1[i]), chan_g[i]);
+		add(pyramid_l0_r[i].mul(pyramid_g0[i]), pyramid_l1_r[i].mul(pyramid_g1[i]), chan_r[i]);
+	}
+
+	// Pyramid reconstruction
+	cv::Mat channel[3], dst;
+	channel[0] = pyramid_fusion(chan_b, levels);
+	channel[1] = pyramid_fusion(chan_g, levels);
+	channel[2] = pyramid_fusion(chan_r, levels);
+	merge(channel, 3, dst);
+	return dst;
+}
+
 cv::Mat illuminationCorrection(cv::Mat src) {												// Homomorphic Filter
 	Mat imgTemp1 = Mat::zeros(src.size(), CV_32FC1);
 	normalize(src, imgTemp1, 0, 1, NORM_MINMAX, CV_32FC1);									// Normalize the channel
@@ -94,6 +308,75 @@ void dftShift(Mat &fImage) {																// Rearranges the quadrants
 	tmp.copyTo(q2);
 }
 
+illuminationParams illuminationParameters(cv::Mat src) {									// Global parameters of the hue and illumination correction
+	illuminationParams p;
+	cv::Mat LAB, lab[3];
+	cvtColor(src, LAB, COLOR_BGR2Lab);
+	split(LAB, lab);
+	p.meanA = mean(lab[1])[0];
+	p.meanB = mean(lab[2])[0];
+	minMaxLoc(lab[0], &p.Lmin, &p.Lmax);
+	if (p.Lmax <= p.Lmin) p.Lmax = p.Lmin + 1;
+
+	cv::Mat imgTemp1;
+	lab[0].convertTo(imgTemp1, CV_32F, 1.0 / (p.Lmax - p.Lmin), -p.Lmin / (p.Lmax - p.Lmin));	// Normalize the channel
+	imgTemp1 = imgTemp1 + 0.000001;
+	log(imgTemp1, imgTemp1);																// Calculate the logarithm
+
+	cv::Mat fftimg;
+	fft(imgTemp1, fftimg);																	// Fourier transform
+
+	// The emphasis filter only attenuates the lowest frequencies, which are the same in the sample and in the whole image
+	// when they are indexed relative to the image size, so the removed component is found here and subtracted in each tile
+	cv::Mat_<float> filter = gaussianFilter(fftimg, 0.7, 1.0, 0.1);
+	cv::Mat_<float> removed = 1.0 - filter;
+	cv::Mat bimg;
+	cv::Mat bchannels[] = { removed, cv::Mat::zeros(removed.size(), CV_32F) };
+	cv::merge(bchannels, 2, bimg);
+	dftShift(bimg);
+	cv::mulSpectrums(fftimg, bimg, fftimg, 0);
+
+	cv::Mat ifftimg;
+	cv::dft(fftimg, ifftimg, cv::DFT_INVERSE | cv::DFT_REAL_OUTPUT);
+	p.lowFreq = ifftimg(Rect(0, 0, src.cols, src.rows)).clone();							// Eliminate the padding
+
+	cv::Mat expimg;
+	cv::exp(imgTemp1 - p.lowFreq, expimg);
+	minMaxLoc(expimg, &p.outMin, &p.outMax);												// Range used to normalize the results
+	if (p.outMax <= p.outMin) p.outMax = p.outMin + 1;
+	return p;
+}
+
+cv::Mat illuminationCorrection(cv::Mat src, illuminationParams p, cv::Rect roi, cv::Size size) {	// Homomorphic Filter of a tile
+	cv::Mat imgTemp1;
+	src.convertTo(imgTemp1, CV_32F, 1.0 / (p.Lmax - p.Lmin), -p.Lmin / (p.Lmax - p.Lmin));	// Normalize with the range of the whole image
+	imgTemp1 = cv::max(imgTemp1, 0.0) + 0.000001;
+	log(imgTemp1, imgTemp1);																// Calculate the logarithm
+
+	double sx = (double)p.lowFreq.cols / size.width, sy = (double)p.lowFreq.rows / size.height;
+	cv::Mat M = (Mat_<double>(2, 3) << sx, 0, (roi.x + 0.5) * sx - 0.5, 0, sy, (roi.y + 0.5) * sy - 0.5);
+	cv::Mat lowFreq;
+	warpAffine(p.lowFreq, lowFreq, M, src.size(), INTER_LINEAR | WARP_INVERSE_MAP, BORDER_REPLICATE);	// Low frequencies of the tile
+	subtract(imgTemp1, lowFreq, imgTemp1);													// Apply the filter
+
+	cv::exp(imgTemp1, imgTemp1);															// Calculate the exponent
+	cv::Mat dst;
+	imgTemp1.convertTo(dst, CV_8U, 255.0 / (p.outMax - p.outMin), -255.0 * p.outMin / (p.outMax - p.outMin));	// Normalize the results
+	return dst;
+}
+
+cv::Mat hueIllumination(cv::Mat src, illuminationParams p, cv::Rect roi, cv::Size size) {	// Corrects the color and illumination of a tile
+	cv::Mat LAB, lab[3], dst;
+	cvtColor(src, LAB, COLOR_BGR2Lab);
+	split(LAB, lab);
+	lab[0] = illuminationCorrection(lab[0], p, roi, size);
+	lab[1] = 127.5 * lab[1] / p.meanA;														// Grey World Assumption with the means of the whole image
+	lab[2] = 127.5 * lab[2] / p.meanB;
+	merge(lab, 3, LAB);
+	cvtColor(LAB, dst, COLOR_Lab2BGR);
+	return dst;
+}
+
 cv::Mat hueIllumination(cv::Mat src) {														// Corrects the color and illumination
 	cv::Mat LAB, lab[3], dst;
 	cvtColor(src, LAB, COLOR_BGR2Lab);														// Conversion to the Lab color model
@@ -114,11 +397,17 @@ void getHistogram(cv::Mat *channel, cv::Mat *hist) {										// Computes the hi
 }
 
 cv::Mat histStretch(cv::Mat src, float percent, int direction) {
+	float channel_min, channel_max;
+	stretchLimits(src, percent, channel_min, channel_max);
+	return stretch(src, channel_min, channel_max, direction);
+}
+
+void stretchLimits(cv::Mat src, float percent, float &channel_min, float &channel_max) {
 	cv::Mat histogram;
 	getHistogram(&src, &histogram);
-	float percent_sum = 0.0, channel_min = -1.0, channel_max = -1.0;
-	float percent_min = percent / 100.0, percent_max = 1.0 - percent_min;
+	float percent_sum = 0.0, percent_min = percent / 100.0, percent_max = 1.0 - percent_min;
 	int i = 0;
+	channel_min = -1.0, channel_max = -1.0;
 
 	while (percent_sum < percent_max * src.total()) {
 		if (percent_sum < percent_min * src.total()) channel_min++;
@@ -126,7 +415,9 @@ cv::Mat histStretch(cv::Mat src, float percent, int direction) {
 		channel_max++;
 		i++;
 	}
+}
 
+cv::Mat stretch(cv::Mat src, float channel_min, float channel_max, int direction) {
 	cv::Mat dst;
 	if (direction == 0) dst = (src - channel_min) * (255.0 - channel_min) / (channel_max - channel_min) + channel_min;	// Stretches the channel towards the Upper side
 	else if (direction == 2) dst = (src - channel_min) * channel_max / (channel_max - channel_min);						// Stretches the channel towards the Lower side
@@ -147,6 +438,35 @@ cv::Mat ICM(vector<Mat_<uchar>> channel, float percent) {								// Integrated C
 	return dst;
 }
 
+icmParams ICMParameters(vector<Mat_<uchar>> channel, float percent) {					// Stretching limits of the Integrated Color Model
+	icmParams p;
+	Mat chan[3], result;
+	for (int i = 0; i < 3; i++) {
+		stretchLimits(channel[i], percent, p.chan_min[i], p.chan_max[i]);
+		chan[i] = stretch(channel[i], p.chan_min[i], p.chan_max[i], 1);
+	}
+	merge(chan, 3, result);
+	Mat HSV, hsv[3];
+	cvtColor(result, HSV, COLOR_BGR2HSV);
+	split(HSV, hsv);
+	p.hsv_min[0] = 0, p.hsv_max[0] = 255;
+	for (int i = 1; i < 3; i++) stretchLimits(hsv[i], percent, p.hsv_min[i], p.hsv_max[i]);
+	return p;
+}
+
+cv::Mat ICM(vector<Mat_<uchar>> channel, icmParams p) {								// Integrated Color Model with global limits
+	Mat chan[3], result;
+	for (int i = 0; i < 3; i++) chan[i] = stretch(channel[i], p.chan_min[i], p.chan_max[i], 1);
+	merge(chan, 3, result);
+	Mat HSV, hsv[3], dst;
+	cvtColor(result, HSV, COLOR_BGR2HSV);
+	split(HSV, hsv);
+	for (int i = 1; i < 3; i++) hsv[i] = stretch(hsv[i], p.hsv_min[i], p.hsv_max[i], 1);
+	merge(hsv, 3, HSV);
+	cvtColor(HSV, dst, COLOR_HSV2BGR);
+	return dst;
+}
+
 cv::Mat dehazing(cv::Mat src) {															// Dehazed an underwater image
 	vector<Mat_<uchar>> src_chan, new_chan;
 	split(src, src_chan);
@@ -181,6 +501,59 @@ cv::Mat dehazing(cv::Mat src) {															// Dehazed an underwater image
 	return dst;
 }
 
+dehazeParams dehazingParameters(cv::Mat src) {											// Global parameters of the dehazing
+	dehazeParams p;
+	vector<Mat_<uchar>> src_chan, new_chan;
+	split(src, src_chan);
+	new_chan.push_back(255 - src_chan[0]);
+	new_chan.push_back(255 - src_chan[1]);
+	new_chan.push_back(src_chan[2]);
+
+	p.size = sqrt(src.total()) / 40;
+	cv::Mat bright_chan = brightChannel(new_chan, p.size);
+
+	vector<float> means;
+	for (int i = 0; i < 3; i++) means.push_back(mean(src_chan[i])[0]);
+	cv::Mat sorted;
+	sortIdx(means, sorted, SORT_EVERY_ROW + SORT_ASCENDING);							// Order of the channels for the maximum color difference
+	for (int i = 0; i < 3; i++) p.order[i] = sorted.at<int>(0, i);
+
+	cv::Mat src_HSV, S;
+	cv::cvtColor(src, src_HSV, COLOR_BGR2HSV);
+	extractChannel(src_HSV, S, 1);
+	minMaxLoc(S, NULL, &p.lambda);
+	p.lambda = p.lambda / 255.0;														// Weight of the rectification
+
+	cv::Mat src_gray;
+	cv::cvtColor(src, src_gray, COLOR_BGR2GRAY);
+	p.A = lightEstimation(src_gray, p.size, bright_chan, new_chan);						// Estimate the atmospheric light
+	return p;
+}
+
+cv::Mat dehazing(cv::Mat src, dehazeParams p) {											// Dehazes an underwater image with the given parameters
+	vector<Mat_<uchar>> src_chan, new_chan;
+	split(src, src_chan);
+	new_chan.push_back(255 - src_chan[0]);
+	new_chan.push_back(255 - src_chan[1]);
+	new_chan.push_back(src_chan[2]);
+
+	cv::Mat bright_chan = brightChannel(new_chan, p.size);
+	cv::Mat mcd = maxColDiff(src_chan, p.order);
+	cv::Mat rectified;
+	addWeighted(bright_chan, p.lambda, mcd, 1.0 - p.lambda, 0.0, rectified);			// Rectify the bright channel image
+	cv::Mat trans = transmittance(rectified, p.A);
+
+	cv::Mat src_gray, filtered;
+	cv::cvtColor(src, src_gray, COLOR_BGR2GRAY);
+	guidedFilter(src_gray, trans, filtered, 30, 0.001, -1);								// Refine the transmittance image
+
+	vector<Mat_<float>> chan_dehazed;
+	chan_dehazed.push_back(new_chan[0]);
+	chan_dehazed.push_back(new_chan[1]);
+	chan_dehazed.push_back(new_chan[2]);
+	return dehaze(chan_dehazed, p.A, filtered);
+}
+
 cv::Mat brightChannel(std::vector<cv::Mat_<uchar>> channels, int size) {				// Generates the Bright Channel Image
 	cv::Mat maxRGB = max(max(channels[0], channels[1]), channels[2]);					// Maximum Color Image
 	cv::Mat element, bright_chan;
@@ -208,6 +581,14 @@ cv::Mat maxColDiff(std::vector<cv::Mat_<uchar>> channels) {								// Generates
 	return mcd;
 }
 
+cv::Mat maxColDiff(std::vector<cv::Mat_<uchar>> channels, const int order[3]) {			// Maximum Color Difference with a given order of the channels
+	cv::Mat a, b, mcd;
+	a = max(channels[order[2]] - channels[order[0]], 0);
+	b = max(channels[order[1]] - channels[order[0]], 0);
+	mcd = 255 - max(a, b);
+	return mcd;
+}
+
 cv::Mat rectify(cv::Mat S, cv::Mat bc, cv::Mat mcd) {									// Rectifies the Bright Channel Image
 	double lambda;
 	minMaxLoc(S, NULL, &lambda);														// Maximum value of the Saturation channel
@@ -316,6 +697,37 @@ cv::Mat saliency(cv::Mat img, cv::Mat kernel) {
 	return saliency;
 }
 
+Scalar saliencyMeans(cv::Mat img, cv::Mat kernel) {
+	cv::Mat blurred, img_Lab;
+	filter2D(img, blurred, img.depth(), kernel);
+	cvtColor(blurred, img_Lab, COLOR_BGR2Lab);
+	return mean(img_Lab);
+}
+
+cv::Mat saliency(cv::Mat img, cv::Mat kernel, Scalar means) {							// Saliency with the means of the whole image
+	cv::Mat blurred, img_Lab;
+	filter2D(img, blurred, img.depth(), kernel);
+	cvtColor(blurred, img_Lab, COLOR_BGR2Lab);
+	cv::Mat chan_lab[3], l, a, b;
+	split(img_Lab, chan_lab);
+	chan_lab[0].convertTo(l, CV_32F);
+	chan_lab[1].convertTo(a, CV_32F);
+	chan_lab[2].convertTo(b, CV_32F);
+	l = means[0] - l;
+	a = means[1] - a;
+	b = means[2] - b;
+	cv::Mat saliency = Mat::zeros(img.rows, img.cols, CV_32F);
+	accumulateSquare(l, saliency);
+	accumulateSquare(a, saliency);
+	accumulateSquare(b, saliency);
+	for (int i = 0; i < img.rows; i++) {
+		for (int j = 0; j < img.cols; j++) {
+			saliency.at<float>(i, j) = sqrt(saliency.at<float>(i, j));
+		}
+	}
+	return saliency;
+}
+
 cv::Mat exposedness(cv::Mat img) {
 	img.convertTo(img, CV_32F, 1.0 / 255.0);
 	cv::Mat exposedness = Mat(img.rows, img.cols, CV_32F);
@@ -617,4 +1029,6 @@ cv::cuda::GpuMat dehaze_GPU(std::vector<cv::cuda::GpuMat> channels, std::vector<
 //Mat lookUpTable(1, 256, CV_32F);
 //for (int i = 0; i < 256; ++i) lookUpTable.at<float>(0,i) = 255.0 * sqrt(0.32 * log(255.0/(255.0-i)));
 //LUT(x, lookUpTable, dst);
-//dst.convertTo(dst, CV_8U);
\ No newline at end of file
+//dst.convertTo(dst, CV_8U);
+
+}	// namespace fusion
\ No newline at end of file
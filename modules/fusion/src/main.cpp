@@ -17,6 +17,7 @@
 
 /// Include auxiliary utility libraries
 #include "../include/fusion.h"
+using namespace fusion;
 
 // Time measurements
 #define _VERBOSE_ON_
@@ -39,6 +40,8 @@ int main(int argc, char *argv[]) {
 		"{show    |       | Show image comparison or not (ON: 1,OFF: 0)}"		// Show image comparison (optional)
 		"{cuda    |       | Use CUDA or not (ON: 1, OFF: 0)}"			        // Use CUDA (if available) (optional)
 		"{time    |       | Show time measurements or not (ON: 1, OFF: 0)}"		// Show time measurements (optional)
+		"{classify|       | Only classify the input without enhancing it (ON: 1, OFF: 0)}"	// Log the fusion decision (optional)
+		"{mem     |0      | Memory budget in MB for the tiled fusion (OFF: 0)}"	// Tiled fusion of very large images (optional)
 		"{help h usage ?  |       | Print help message}";						// Show help (optional)
 
 	CommandLineParser cvParser(argc, argv, keys);
@@ -48,8 +51,8 @@ int main(int argc, char *argv[]) {
 	std::cout << ABOUT_STRING << endl;
 	std::cout << endl << "Built with OpenCV " << CV_VERSION << endl;
 
-	// If the number of arguments is lower than 4, or contains "help" keyword, then we show the help
-	if (argc < 5 || cvParser.has("help")) {
+	// If the input or the output is missing, or contains "help" keyword, then we show the help
+	if (argc < 3 || cvParser.has("help")) {
 		std::cout << endl << "C++ Module for fusion enhancement" << endl;
 		std::cout << endl << "Arguments are:" << endl;
 		std::cout << "\t*Input: Input image name with path and extension" << endl;
@@ -57,6 +60,8 @@ int main(int argc, char *argv[]) {
 		std::cout << "\t*-cuda=0 or -cuda=1 (ON: 1, OFF: 0)" << endl;
 		std::cout << "\t*-time=0 or -time=1 (ON: 1, OFF: 0)" << endl;
 		std::cout << "\t*-show=0 or -show=1 (ON: 1, OFF: 0)" << endl;
+		std::cout << "\t*-classify=0 or -classify=1 (ON: 1, OFF: 0)" << endl;
+		std::cout << "\t*-mem=<MB> Memory budget of the tiled fusion, the input and output images are not included (OFF: 0)" << endl;
 		std::cout << endl << "Example:" << endl;
 		std::cout << "\timg1.jpg img2.jpg -cuda=0 -time=0 -show=0 -d=S -m=F" << endl;
 		std::cout << "\tThis will open 'input.jpg' enhance the image and save it in 'output.jpg'" << endl << endl;
@@ -66,12 +71,16 @@ int main(int argc, char *argv[]) {
 	int CUDA = 0;                                   // Default option (running with CPU)
 	int Time = 0;                                   // Default option (not showing time)
 	int Show = 0;                                   // Default option (not showing comparison)
+	int Classify = 0;                               // Default option (classifying and enhancing)
+	int Mem = 0;                                    // Default option (fusion of the whole image)
 
 	std::string InputFile = cvParser.get<cv::String>(0);	// String containing the input file path+name+extension from cvParser function
 	std::string OutputFile = cvParser.get<cv::String>(1);	// String containing the input file path+name+extension from cvParser function
 	std::string implementation;								// CPU or GPU implementation
 	Show = cvParser.get<int>("show");						// Gets argument -show=x, where 'x' defines if the matches will show or not
 	Time = cvParser.get<int>("time");						// Gets argument -time=x, where 'x' defines if execution time will show or not
+	Classify = cvParser.get<int>("classify");				// Gets argument -classify=x, where 'x' defines if only the classification is done
+	Mem = cvParser.get<int>("mem");							// Gets argument -mem=x, where 'x' is the memory budget of the tiled fusion in MB
 
 	// Check if any error occurred during parsing process
 	if (!cvParser.check()) {
@@ -129,113 +138,41 @@ int main(int argc, char *argv[]) {
 	}
 #endif
 
-	std::cout << endl << "Applying fusion enhancement" << endl;
-
-	// CPU Implementation
-	if (!CUDA) {
-		cv::Mat HSV, LAB, chanHSV[3], chanLAB[3];
-		cvtColor(input, HSV, cv::COLOR_BGR2HSV);
-		split(HSV, chanHSV);
-		cvtColor(input, LAB, cv::COLOR_BGR2Luv);
-		split(LAB, chanLAB);
-		Scalar meanS, stddevS, meanV, stddevV;
-		meanStdDev(chanHSV[1], meanS, stddevS);
-		meanStdDev(chanHSV[2], meanV, stddevV);
-
-		Mat src[2];
-		vector<Mat_<uchar>> channels;
-		split(input, channels);
-		bool flag = 0;
-
-		// Histogram Stretching or Hue and Illumination Correction
-		if ((meanV[0] <= 115 & (mean(chanLAB[1])[0] <= 110 | mean(chanLAB[2])[0] <= 110)) | (meanS[0] >= 240 & stddevS[0] <= 15)) {
-			src[0] = hueIllumination(input);
-			flag = 1;
-		}
-		else src[0] = ICM(channels, 0.5);
-
-		// Dehazing or Hue and Illumination Correction
-		if (stddevV[0] >= 65 | (meanV[0] >= 160 & (mean(chanLAB[1])[0] <= 100 | mean(chanLAB[2])[0] <= 100))) {
-			if (flag == 1) dst = src[0];
-			else src[1] = hueIllumination(input);
-		}
-		else src[1] = dehazing(input);
-
-		if (dst.empty()) {
-			cv::Mat Lab[2], L[2];
-			cvtColor(src[0], Lab[0], COLOR_BGR2Lab);
-			extractChannel(Lab[0], L[0], 0);
-			cvtColor(src[1], Lab[1], COLOR_BGR2Lab);
-			extractChannel(Lab[1], L[1], 0);
-
-			cv::Mat kernel = filter_mask();
-
-			// Normalized weights
-			vector<Mat> w1_norm, w2_norm, w3_norm, w4_norm;
-			w1_norm = weight_norm(laplacian_contrast(L[0]), laplacian_contrast(L[1]));
-			w2_norm = weight_norm(local_contrast(L[0], kernel), local_contrast(L[1], kernel));
-			w3_norm = weight_norm(saliency(src[0], kernel), saliency(src[1], kernel));
-			w4_norm = weight_norm(exposedness(L[0]), exposedness(L[1]));
-
-			// Weight sum of each input
-			cv::Mat w_norm[2];
-			w_norm[0] = (w1_norm[0] + w2_norm[0] + w3_norm[0] + w4_norm[0]) / 4;
-			w_norm[1] = (w1_norm[1] + w2_norm[1] + w3_norm[1] + w4_norm[1]) / 4;
-
-			// Gaussian pyramids of the weights
-			int levels = 5;
-			vector<Mat> pyramid_g0, pyramid_g1;
-			buildPyramid(w_norm[0], pyramid_g0, levels - 1);
-			buildPyramid(w_norm[1], pyramid_g1, levels - 1);
-
-			cv::Mat channels_0[3], channels_1[3];
-			split(src[0], channels_0);
-			split(src[1], channels_1);
-
-			// Laplacian pyramids of the inputs channels (BGR)
-			vector<Mat_<float>> pyramid_l0_b = laplacian_pyramid(channels_0[0], levels);
-			vector<Mat_<float>> pyramid_l0_g = laplacian_pyramid(channels_0[1], levels);
-			vector<Mat_<float>> pyramid_l0_r = laplacian_pyramid(channels_0[2], levels);
+	// Selection of the enhancement of each input
+	fusionClass inputs = classifyInput(input, THUMBNAIL_SIZE);
+	const char *names1[] = { "ICM", "Hue and Illumination Correction" };
+	const char *names2[] = { "Dehazing", "Hue and Illumination Correction", "None" };
+	std::cout << endl << "Input 1: " << names1[inputs.input1] << endl;
+	std::cout << "Input 2: " << names2[inputs.input2] << endl;
 
-			vector<Mat_<float>> pyramid_l1_b = laplacian_pyramid(channels_1[0], levels);
-			vector<Mat_<float>> pyramid_l1_g = laplacian_pyramid(channels_1[1], levels);
-			vector<Mat_<float>> pyramid_l1_r = laplacian_pyramid(channels_1[2], levels);
-
-			// Fusion of the inputs with their respective weights
-			Mat chan_b[5], chan_g[5], chan_r[5];
-			for (int i = 0; i < 5; i++) {
-				pyramid_g0[i].convertTo(pyramid_g0[i], CV_32F);
-				pyramid_g1[i].convertTo(pyramid_g1[i], CV_32F);
-				add(pyramid_l0_b[i].mul(pyramid_g0[i]), pyramid_l1_b[i].mul(pyramid_g1[i]), chan_b[i]);
-				add(pyramid_l0_g[i].mul(pyramid_g0[i]), pyramid_l1_g[i].mul(pyramid_g1[i]), chan_g[i]);
-				add(pyramid_l0_r[i].mul(pyramid_g0[i]), pyramid_l1_r[i].mul(pyramid_g1[i]), chan_r[i]);
-			}
+	if (Classify) {
+		// Name for the output csv file where the classification will be saved
+		std::size_t pos;
+		if (OutputFile.find(92) != std::string::npos) pos = OutputFile.find_last_of(92);	// If string contains '\' search for the last one
+		else pos = OutputFile.find_last_of('/');											// If does not contain '\' search for the last '/'
+		std::string Output = OutputFile.substr(0, pos + 1);
+		std::string ext = "fusion_classification.csv";
+		Output.insert(pos + 1, ext);
+		ofstream file;
+		file.open(Output, std::ios::app);
+		file << endl << InputFile << ";" << inputs.input1 << ";" << inputs.input2 << ";" << fixed << setprecision(3) << inputs.meanS << ";" << inputs.stddevS << ";"
+			<< inputs.meanV << ";" << inputs.stddevV << ";" << inputs.meanU << ";" << inputs.meanv;
+		std::cout << endl << "Classification saved in " << Output << endl;
+		return 0;
+	}
 
-			// Pyramid reconstruction
-			cv::Mat channel[3];
-			channel[0] = pyramid_fusion(chan_b, levels);
-			channel[1] = pyramid_fusion(chan_g, levels);
-			channel[2] = pyramid_fusion(chan_r, levels);
-			merge(channel, 3, dst);
-			
-			//Mat test;
-			//vconcat(src[0], src[1], test);
-			//imwrite(OutputFile + "_t.jpg", test);
+	std::cout << endl << "Applying fusion enhancement" << endl;
 
-			//Mat weight1, weight2, weights;
-			//hconcat(w1_norm[0], w2_norm[0], weight1);
-			//hconcat(weight1, w3_norm[0], weight1);
-			//hconcat(weight1, w4_norm[0], weight1);
-			//hconcat(weight1, w_norm[0], weight1);
-			//hconcat(w1_norm[1], w2_norm[1], weight2);
-			//hconcat(weight2, w3_norm[1], weight2);
-			//hconcat(weight2, w4_norm[1], weight2);
-			//hconcat(weight2, w_norm[1], weight2);
-			//vconcat(weight1, weight2, weights);
-			//imwrite(OutputFile + "_w.jpg", 255.0*weights);
-		}
+	// CPU Implementation (Tiled)
+	if (!CUDA && Mem > 0) {
+		int workers, tiles;
+		dst = fusionTiled(input, inputs, Mem, &workers, &tiles);
+		std::cout << "Tiled fusion: " << tiles << " tiles processed by " << workers << " workers" << endl;
 	}
 
+	// CPU Implementation
+	else if (!CUDA) dst = fusionEnhance(input, inputs);
+
 	//  End time measurement (Showing time results is optional)
 	if (Time) {
 		t = 1000 * ((double)getTickCount() - t) / getTickFrequency();
@@ -39,12 +39,21 @@ using namespace std;
 #include "opencv2/cudaarithm.hpp"
 #endif
 
+// Functions of the module, built as illumination_lib and also linked by the benchmark module
+namespace illumination {
+
 /*
 	@brief		Corrects ununinform illumination using a homomorphic filter
 	@function	illuminationCorrection(cv::Mat src)
 */
 cv::Mat illuminationCorrection(cv::Mat src);
 
+/*
+	@brief		Corrects the illumination of a color image by filtering the L channel of its Lab representation
+	@function	cv::Mat correctIllumination(cv::Mat src)
+*/
+cv::Mat correctIllumination(cv::Mat src);
+
 /*
 	@brief		Computes the Normalized Discrete Fourier Transform
 	@function	void fft(const cv::Mat &src, cv::Mat &dst)
@@ -61,4 +70,6 @@ cv::Mat gaussianFilter(cv::Mat img, float sigma, float high, float low);
 	@brief		Rearranges the quadrants of a zero centered filter
 	@function	void dftShift(Mat &fImage)
 */
-void dftShift(Mat &fImage);
\ No newline at end of file
+void dftShift(Mat &fImage);
+
+}	// namespace illumination
\ No newline at end of file
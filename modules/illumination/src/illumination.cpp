@@ -16,6 +16,18 @@
 /// Include auxiliary utility libraries
 #include "../include/illumination.h"
 
+namespace illumination {
+
+cv::Mat correctIllumination(cv::Mat src) {												// Illumination correction of a color image
+	cv::Mat LAB, lab[3], dst;
+	cvtColor(src, LAB, COLOR_BGR2Lab);														// Conversion to the Lab color model
+	split(LAB, lab);
+	lab[0] = illuminationCorrection(lab[0]);												// Correction of ununiform illumination
+	merge(lab, 3, LAB);
+	cvtColor(LAB, dst, COLOR_Lab2BGR);														// Conversion to the BGR color model
+	return dst;
+}
+
 cv::Mat illuminationCorrection(cv::Mat src) {												// Homomorphic Filter
 	Mat imgTemp1 = Mat::zeros(src.size(), CV_32FC1);
 	normalize(src, imgTemp1, 0, 1, NORM_MINMAX, CV_32FC1);									// Normalize the channel
@@ -92,4 +104,6 @@ void dftShift(Mat &fImage) {																// Rearranges the quadrants
 	q1.copyTo(tmp);
 	q2.copyTo(q1);
 	tmp.copyTo(q2);
-}
\ No newline at end of file
+}
+
+}	// namespace illumination
\ No newline at end of file
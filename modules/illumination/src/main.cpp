@@ -17,6 +17,7 @@
 
 /// Include auxiliary utility libraries
 #include "../include/illumination.h"
+using namespace illumination;
 
 // Time measurements
 #define _VERBOSE_ON_
@@ -132,14 +133,7 @@ int main(int argc, char *argv[]) {
 	std::cout << endl << "Applying illumination correction" << endl;
 
 	// CPU Implementation
-	if (!CUDA) {
-		cv::Mat LAB, lab[3];
-		cvtColor(input, LAB, COLOR_BGR2Lab);													// Conversion to the Lab color model
-		split(LAB, lab);
-		lab[0] = illuminationCorrection(lab[0]);												// Correction of ununiform illumination
-		merge(lab, 3, LAB);
-		cvtColor(LAB, dst, COLOR_Lab2BGR);														// Conversion to the BGR color model
-	}
+	if (!CUDA) dst = correctIllumination(input);
 
 	//  End time measurement (Showing time results is optional)
 	if (Time) {
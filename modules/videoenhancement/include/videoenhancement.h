@@ -14,10 +14,21 @@
 
 ///Basic C and C++ libraries
 #include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
 #include <iomanip>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <array>
 
 /// OpenCV libraries. May need review for the final release
 #include <opencv2/core.hpp>
@@ -32,6 +43,12 @@ using namespace cuda;
 using namespace std;
 using namespace ximgproc;
 
+/// Binary standard input and output of the raw frames
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
 /// CUDA specific libraries
 #if USE_GPU
 #include <opencv2/cudafilters.hpp>
@@ -45,12 +62,50 @@ using namespace ximgproc;
 */
 cv::Mat histStretch(cv::Mat prev, cv::Mat src, float percent, int direction);
 
+/*
+	@brief		Finds the limits of the histogram stretching leaving out a percent of the total in each side
+	@function	void histLimits(cv::Mat histogram, double total, float percent, float &channel_min, float &channel_max)
+*/
+void histLimits(cv::Mat histogram, double total, float percent, float &channel_min, float &channel_max);
+
+/*
+	@brief		Stretches one image channel between the given limits in a specific direction (right 0, both sides 1 or left 2)
+	@function	cv::Mat stretch(cv::Mat src, float channel_min, float channel_max, int direction)
+*/
+cv::Mat stretch(cv::Mat src, float channel_min, float channel_max, int direction);
+
+/*
+	@brief		Exponentially weighted histograms of the channels of the video frames. Each new frame is blended in O(256)
+				per channel with a weight given by the time constant in frames, so the stretching limits follow the video
+				smoothly without blending whole frames. With a scale over 1 the histograms are taken from a strided sample
+*/
+class histState {
+public:
+	histState(int channels, double frames, int scale = 1);
+	void update(const cv::Mat &frame);			// Adds the histograms of a new frame
+	void limits(int channel, float percent, float &channel_min, float &channel_max) const;
+	void reset();								// Forgets the previous frames
+	bool empty() const { return !seeded; }
+
+private:
+	cv::Mat hist;								// One row of 256 normalized bins per channel
+	double alpha;								// Weight of the new frame
+	int scale;									// Sampling step of the frames
+	bool seeded;
+};
+
 /*
 	@brief		Enhances the contrast of an image using the Integrated Color Model by Iqbal et al. based on histogram stretching
 	@function	cv::Mat ICM(cv::Mat prev, cv::Mat src, float percent)
 */
 cv::Mat ICM(cv::Mat prev, cv::Mat src, float percent);
 
+/*
+	@brief		Integrated Color Model using the stretching limits of the temporal histograms, updated before with the frame
+	@function	cv::Mat ICM(histState &state, cv::Mat src, float percent)
+*/
+cv::Mat ICM(histState &state, cv::Mat src, float percent);
+
 /*
 	@brief		Corrects the color of an image using Grey World Assumption and histogram strething
 	@function	cv::Mat UCM(cv::Mat src, float percent);
@@ -63,6 +118,77 @@ cv::Mat colorcorrection(cv::Mat src);
 */
 cv::Mat dehazing(cv::Mat prev, cv::Mat src);
 
+/*
+	@brief		Dehazing parameters reused across the video frames. They are estimated again every some frames or when the
+				temporal average drifts from the one they were estimated on
+*/
+struct dehazeState {
+	int every = 1;								// Maximum frames between estimations
+	double drift = 0.02;						// Mean absolute change of the average (0 to 1) that forces an estimation (OFF: 0)
+	bool cache = false;							// Reuses the transmittance image too, not only the light and lambda
+	vector<uchar> A;							// Atmospheric light
+	double lambda = 0;							// Weight of the bright channel in the rectification
+	cv::Mat trans;								// Last refined transmittance
+	cv::Mat thumb;								// Thumbnail of the average of the last estimation
+	int level = 0;								// Quality: 0 full, 1 and 2 estimation at 1/2 and 1/4 resolution, 3 reuses the transmittance
+	int age = 0, frames = 0, estimations = 0;
+};
+
+/*
+	@brief		Dehazes a video frame reusing the parameters of the state, only the radiance recovery is done for every frame.
+				The temporal average prev can be smaller than the frame, then the parameters are estimated at its resolution
+	@function	cv::Mat dehazing(dehazeState &state, cv::Mat prev, cv::Mat src)
+*/
+cv::Mat dehazing(dehazeState &state, cv::Mat prev, cv::Mat src);
+
+/*
+	@brief		Computes the refined transmittance of the blended image, estimating the light and lambda of the state if light
+	@function	cv::Mat dehazingParameters(cv::Mat sum, dehazeState &state, bool light, int radius)
+*/
+cv::Mat dehazingParameters(cv::Mat sum, dehazeState &state, bool light, int radius = 30);
+
+/*
+	@brief		Chooses the quality level of each frame to keep its enhancement time within a budget. The level is lowered
+				when the averaged time gets close to the budget and raised again after some frames well within it. Each frame
+				is logged with its level and time
+*/
+class deadlineScheduler {
+public:
+	deadlineScheduler(double budget, int levels, std::string log);
+	int level() const { return current; }
+	void update(double ms);						// Enhancement time of the last frame
+	void report();
+
+	int frames, misses;
+
+private:
+	double budget, average;						// Budget and averaged time of the frames in ms
+	int current, levels, calm;					// Current level, number of levels and frames well within the budget
+	vector<int> perLevel;
+	ofstream file;
+	std::string name;
+};
+
+/*
+	@brief		Enhances the video in time chunks with parallel worker processes running the given command and joins their
+				outputs, reporting the load balance of the chunks. Each chunk warms up its temporal state with the previous
+				frames. Fails if the output does not have the frames of the input
+	@function	bool processChunks(std::string command, std::string input, std::string output, int workers, int warmup, int n_frames, double FPS, cv::Size size)
+*/
+bool processChunks(std::string command, std::string input, std::string output, int workers, int warmup, int n_frames, double FPS, cv::Size size);
+
+/*
+	@brief		Quotes an argument of a shell command so it is passed unchanged, whatever characters it contains
+	@function	std::string shellQuote(const std::string &arg)
+*/
+std::string shellQuote(const std::string &arg);
+
+/*
+	@brief		Joins video files with an ffmpeg stream copy, or encoding their frames again if ffmpeg is not available
+	@function	bool concatVideos(vector<std::string> parts, std::string output, double FPS, cv::Size size)
+*/
+bool concatVideos(vector<std::string> parts, std::string output, double FPS, cv::Size size);
+
 /*
 	@brief		Generates the Bright Channel Image of an underwater image
 	@function	cv::Mat brightChannel(vector<Mat_<uchar>> channels, int size)
@@ -97,4 +223,232 @@ cv::Mat transmittance(cv::Mat correct, vector<uchar> A);
 	@brief		Dehazes the underwater image
 	@function	cv::Mat dehaze(vector<Mat_<float>> channels, vector<uchar> A, cv::Mat trans)
 */
-cv::Mat dehaze(vector<Mat_<float>> channels, vector<uchar> A, cv::Mat trans);
\ No newline at end of file
+cv::Mat dehaze(vector<Mat_<float>> channels, vector<uchar> A, cv::Mat trans);
+
+/*
+	@brief		Fixed capacity ring buffer of preallocated frames used as the temporal window. The frames are stored
+				by slot index and never moved, so adding and removing a frame is O(1). Without the pipeline threads the
+				frames are decoded in place and the window never allocates. With them the slots exchange their buffers with
+				the decoded frames instead of copying them, the previous buffers go back to the decoder for reuse
+*/
+class frameRing {
+public:
+	frameRing(int capacity, cv::Size size, int type);
+	cv::Mat &next();							// Free slot where the next frame is written before calling push()
+	void push();								// Adds the frame written in next() as the newest one
+	void pop();									// Removes the oldest frame
+	cv::Mat &operator[](int i);					// i-th oldest frame in the window
+	int size() const { return count; }
+	int capacity() const { return (int)slots.size(); }
+	bool full() const { return count == (int)slots.size(); }
+	size_t bytes() const;						// Memory of the frames held by the window
+
+private:
+	std::vector<cv::Mat> slots;
+	int head, count;
+};
+
+/*
+	@brief		Integer running sum of the 8 bit frames of the temporal window. The sum uses 16 bit lanes when the window is
+				short enough to never overflow them and 32 bit lanes otherwise, and the average is read through a table of
+				the rounded quotients, so the frames are never converted to float and the averages are bit exact
+*/
+class runningSum {
+public:
+	runningSum(cv::Size size, int channels, int capacity);
+	void add(const cv::Mat &frame);				// Adds a frame to the sum
+	void average(cv::Mat &dst, int frames);		// Rounded average of the frames in the sum
+	void slide(cv::Mat &dst, const cv::Mat &oldest, int frames);	// Average and removal of the oldest frame in one pass
+	void reset();
+	size_t bytes() const { return sum.total() * sum.elemSize() + lut.size(); }
+
+private:
+	void apply(const cv::Mat *in, const cv::Mat *out, cv::Mat *avg);
+	void divisor(int frames);					// Table of the quotients by the number of frames
+
+	cv::Mat sum;
+	vector<uchar> lut;
+	int capacity, frames;
+};
+
+
+/*
+	@brief		Scene change detector. Compares a joint color histogram of a nearest neighbour thumbnail of each frame with the
+				one of the previous frame, a Bhattacharyya distance over the threshold is a cut
+*/
+class sceneCut {
+public:
+	sceneCut(double threshold);
+	bool detect(const cv::Mat &frame);			// True when the frame starts a new scene
+	void report(double enhancement);			// Prints the cuts and the cost compared with the enhancement time in seconds
+
+	double threshold;							// Bhattacharyya distance of a cut (OFF: 0)
+	int frames, cuts;
+	int64 time;									// Ticks spent detecting
+
+private:
+	cv::Mat thumb, hist, prevHist;
+};
+
+/*
+	@brief		Log linear histogram of latencies in the style of HdrHistogram. The values are kept in microseconds with 32 sub
+				buckets per power of two (3 % precision), so recording is O(1) and the memory is fixed
+*/
+class latencyHistogram {
+public:
+	latencyHistogram();
+	void record(double ms);
+	double percentile(double p) const;			// Latency in ms under which p percent of the values are
+	double max() const { return worst; }
+	int64 count() const { return total; }
+
+private:
+	vector<int64> buckets;
+	double worst;
+	int64 total;
+};
+
+enum { STAGE_DECODE, STAGE_STATISTICS, STAGE_ENHANCE, STAGE_ENCODE, STAGES };
+
+/*
+	@brief		Timings of the stages of a video run (decoding, temporal statistics, enhancement and encoding). Every timing is
+				added to the histogram of its stage and, if perFrame, to the row of its frame for the CSV file
+*/
+class videoTelemetry {
+public:
+	videoTelemetry(bool perFrame);
+	void record(int stage, int frame, double ms);	// Thread safe
+	void report();								// Prints p50, p95, p99 and max of each stage
+	bool save(std::string file, std::string name);	// Writes the timings of every frame in a csv file
+
+private:
+	latencyHistogram hist[STAGES];
+	int worstFrame[STAGES];
+	std::mutex lock;
+	bool perFrame;
+	vector<std::array<float, STAGES>> frames;
+};
+
+/*
+	@brief		Bounded FIFO queue shared between threads. push() blocks while the queue is full (back-pressure) and pop()
+				blocks while it is empty. After close() the pending items can still be popped and push() fails
+*/
+template <typename T> class boundedQueue {
+public:
+	boundedQueue(size_t capacity) : limit(std::max<size_t>(1, capacity)), closed(false) {}
+
+	bool push(const T &item) {					// Waits for a free place, returns false if the queue was closed
+		std::unique_lock<std::mutex> lock(m);
+		notFull.wait(lock, [this] { return items.size() < limit || closed; });
+		if (closed) return false;
+		items.push_back(item);
+		notEmpty.notify_one();
+		return true;
+	}
+
+	bool pop(T &item) {							// Waits for an item, returns false once the queue is closed and empty
+		std::unique_lock<std::mutex> lock(m);
+		notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+		if (items.empty()) return false;
+		item = items.front();
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	bool tryPush(const T &item) {				// Non blocking push, returns false if the queue is full or closed
+		std::lock_guard<std::mutex> lock(m);
+		if (items.size() >= limit || closed) return false;
+		items.push_back(item);
+		notEmpty.notify_one();
+		return true;
+	}
+
+	size_t capacity() const { return limit; }
+
+	bool tryPop(T &item) {						// Non blocking pop, returns false if the queue is empty
+		std::lock_guard<std::mutex> lock(m);
+		if (items.empty()) return false;
+		item = items.front();
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	void close() {
+		std::lock_guard<std::mutex> lock(m);
+		closed = true;
+		notFull.notify_all();
+		notEmpty.notify_all();
+	}
+
+private:
+	std::deque<T> items;
+	size_t limit;
+	bool closed;
+	std::mutex m;
+	std::condition_variable notFull, notEmpty;
+};
+
+/*
+	@brief		Pipelined video runner. A decoder thread reads the frames and an encoder thread writes the enhanced video while
+				the calling thread enhances, so the three stages overlap. The comparison is composed in a preallocated canvas
+				and encoded by a fourth thread. The stages are connected by
+				bounded queues of depth frames, 0 runs everything in the calling thread. The frames keep their order since
+				every stage is a single thread. Frames returned by read() and queued by write() must not be modified afterwards.
+				Stateless methods can use process(), which enhances the frames in several worker threads and reorders them
+				before the encoder. A chunk of the video reads at most total frames and only writes keep frames after the
+				first skip ones. In raw mode the frames are read from the standard input and written to the standard output as
+				BGR24 pixels without any container or codec, and the latency of every frame is measured
+*/
+class videoPipeline {
+public:
+	videoPipeline(cv::VideoCapture &cap, cv::VideoWriter &out, cv::VideoWriter *comp, int depth, int skip = 0, int keep = -1, int total = -1);
+	~videoPipeline();
+	bool read(cv::Mat &frame);					// Next frame of the video, false at the end
+	void write(const cv::Mat &src, const cv::Mat &dst);	// Queues the enhanced frame and its original for the comparison
+	void process(int workers, int inflight, std::function<cv::Mat(const cv::Mat &)> enhance);	// Enhances every frame independently
+	void finish();								// Waits until every queued frame is written
+	void report();								// Prints the utilization of each stage
+	double enhancementTime();					// Seconds spent by the enhancement stage
+	void raw(cv::Size size, bool log);			// Raw frames of the given size, printing each latency in the error output if log
+	void monitor(videoTelemetry *telemetry);	// Records the timings of every frame
+	int buffers() const;						// Frames the queues between the threads can hold, besides the window
+
+private:
+	void begin();
+	bool grab(cv::Mat &frame);					// Reads a frame from the video or the standard input
+	void decode();
+	void encode();
+	bool output(const cv::Mat &src, const cv::Mat &dst);	// Writes a frame if it belongs to the chunk
+	void compare();
+	void composite(const cv::Mat &src, const cv::Mat &dst);	// Writes the original and the enhanced frame side by side
+	void work(std::function<cv::Mat(const cv::Mat &)> &enhance);
+
+	cv::VideoCapture &cap;
+	cv::VideoWriter &out;
+	cv::VideoWriter *comp;
+	cv::Mat canvas;								// Comparison of the original and enhanced frames
+	bool threaded, finished;
+	boundedQueue<cv::Mat> decoded, recycled;	// Decoded frames and buffers given back to the decoder
+	boundedQueue<std::pair<cv::Mat, cv::Mat>> encoded, compared;
+	std::thread decoder, encoder, comparer;
+	int64 start, end, decodeTime, encodeTime, waitTime, compareTime;	// Ticks spent by each stage, waitTime is the enhancement stage waiting
+	int count;
+	int skip, keep, total, decodedFrames, encodedFrames;	// Frames of the chunk (all: -1)
+
+	// Frame parallel enhancement
+	std::map<int, std::pair<cv::Mat, cv::Mat>> pending;	// Reorder buffer of the frames finished out of order
+	std::mutex takeLock, orderLock;
+	std::condition_variable released;
+	int workers, limit, taken, written;			// Frames given to the workers and frames passed in order to the encoder
+	int64 workTime;
+
+	// Latency
+	bool started, logLatency;
+	cv::Size rawSize;
+	std::deque<int64> stamps;					// Read time of the frames not written yet
+	std::mutex stampLock;
+	vector<double> latencies;					// Milliseconds from the read to the write of each frame
+	videoTelemetry *telemetry;
+};
\ No newline at end of file
@@ -38,11 +38,39 @@ int main(int argc, char *argv[]) {
 		"{comp    |       | Save video comparison (ON: 1, OFF: 0)}"				// Show video comparison (optional)
 		"{cuda    |       | Use CUDA or not (CUDA ON: 1, CUDA OFF: 0)}"         // Use CUDA (optional)
 		"{time    |       | Show time measurements or not (ON: 1, OFF: 0)}"		// Show time measurements (optional)
+		"{queue   |4      | Frames queued between the pipeline stages (OFF: 0)}"	// Decoding and encoding threads (optional)
+		"{threads |1      | Worker threads for the C and E methods}"				// Frame parallel enhancement (optional)
+		"{inflight|0      | Frames in flight with several workers (default: 2 per worker)}"	// Memory limit of the workers (optional)
+		"{tau     |2      | Time constant in seconds of the histograms of the H method}"	// Temporal smoothing (optional)
+		"{every   |1      | Maximum frames between estimations of the D method parameters}"	// Amortized dehazing (optional)
+		"{drift   |0.02   | Change of the average that forces an estimation (OFF: 0)}"	// Amortized dehazing (optional)
+		"{cachetrans|     | Reuse the transmittance image between estimations (ON: 1, OFF: 0)}"	// Amortized dehazing (optional)
+		"{cut     |0.5    | Histogram distance of a scene cut for the H and D methods (OFF: 0)}"	// Scene cut detection (optional)
+		"{scale   |1      | Downsampling of the temporal statistics of the H and D methods}"	// Reduced temporal average (optional)
+		"{chunks  |0      | Worker processes that enhance a time chunk each (OFF: 0)}"	// Chunked processing (optional)
+		"{start   |-1     | First frame written by a chunk}"						// Chunk of a worker process (internal)
+		"{count   |-1     | Frames written by a chunk (all: -1)}"					// Chunk of a worker process (internal)
+		"{warmup  |0      | Frames before the chunk used to warm up the temporal state}"	// Chunk of a worker process (internal)
+		"{out     |       | Output video file}"										// Output file of a chunk (internal)
+		"{raw     |       | Frame size WxH of raw BGR24 frames in stdin and stdout}"	// Raw streaming (optional)
+		"{fps     |30     | Frame rate of the raw frames}"							// Raw streaming (optional)
+		"{deadline|0      | Enhancement time budget per frame in ms of the D method (OFF: 0)}"	// Adaptive quality (optional)
+		"{framelog|0      | Save the stage timings of every frame in a csv file (ON: 1, OFF: 0)}"	// Per frame telemetry (optional)
 		"{help h usage ?  |       | Print help message}";						// Show help (optional)
 
 	CommandLineParser cvParser(argc, argv, keys);
 	cvParser.about(ABOUT_STRING);												// Adds "about" information to the parser method
 
+	// In raw mode the standard output carries the frames, so the messages go to the error output
+	int Raw = cvParser.has("raw") && !cvParser.get<cv::String>("raw").empty();
+	if (Raw) {
+		std::cout.rdbuf(std::cerr.rdbuf());
+#ifdef _WIN32
+		_setmode(_fileno(stdin), _O_BINARY);
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+	}
+
 	//**************************************************************************
 	std::cout << ABOUT_STRING << endl;
 	std::cout << "\nBuilt with OpenCV" << CV_VERSION << endl;
@@ -55,6 +83,20 @@ int main(int argc, char *argv[]) {
 		std::cout << "\t*-comp=0 or -comp=1 (ON: 1, OFF: 0)" << endl;
 		std::cout << "\t*-cuda=0 or -cuda=1 (ON: 1, OFF: 0)" << endl;
 		std::cout << "\t*-time=0 or -time=1 (ON: 1, OFF: 0)" << endl;
+		std::cout << "\t*-queue=<n> Frames queued between the decoding, enhancement and encoding threads (single thread: 0)" << endl;
+		std::cout << "\t*-threads=<n> Frames enhanced in parallel by the C and E methods (default: 1)" << endl;
+		std::cout << "\t*-inflight=<n> Maximum frames being enhanced or reordered with several threads (default: 2 per thread)" << endl;
+		std::cout << "\t*-tau=<s> Time constant in seconds of the temporal histograms of the H method (default: 2)" << endl;
+		std::cout << "\t*-every=<K> Maximum frames between estimations of the dehazing parameters (default: 1)" << endl;
+		std::cout << "\t*-drift=<x> Mean change of the temporal average (0 to 1) that forces an estimation (default: 0.02)" << endl;
+		std::cout << "\t*-cachetrans=0 or -cachetrans=1 Reuse the transmittance image between estimations (ON: 1, OFF: 0)" << endl;
+		std::cout << "\t*-cut=<x> Bhattacharyya distance (0 to 1) between frames that resets the temporal state (default: 0.5, OFF: 0)" << endl;
+		std::cout << "\t*-scale=<n> Width and height divisor of the temporal average and histograms, e.g. 4 or 8 (default: 1)" << endl;
+		std::cout << "\t*-chunks=<n> Splits the video in n time chunks enhanced by parallel processes (OFF: 0)" << endl;
+		std::cout << "\t*-raw=<W>x<H> Reads raw BGR24 frames from stdin and writes the enhanced frames to stdout (input: -)" << endl;
+		std::cout << "\t*-fps=<f> Frame rate of the raw frames (default: 30)" << endl;
+		std::cout << "\t*-deadline=<ms> Lowers the quality of the dehazing to enhance each frame within the budget (OFF: 0)" << endl;
+		std::cout << "\t*-framelog=0 or -framelog=1 Saves the decoding, statistics, enhancement and encoding times of every frame (ON: 1, OFF: 0)" << endl;
 		std::cout << "\t*Argument 'm=<method>' is a string containing a list of the desired method to use" << endl;
 		std::cout << endl << "Complete options are:" << endl;
 		std::cout << "\t-m=C for Color Correction" << endl;
@@ -70,12 +112,38 @@ int main(int argc, char *argv[]) {
 	int CUDA = 0;										// Default option (running with CPU)
 	int Time = 0;                                       // Default option (not showing time)
 	int Comp = 0;										// Default option (not showing results)
+	int Queue = 4;										// Default option (pipelined decoding and encoding)
+	int Threads = 1;									// Default option (one enhancement thread)
+	int InFlight = 0;									// Default option (two frames in flight per thread)
+	double Tau = 2;										// Default option (2 s time constant)
+	dehazeState Dehaze;									// Default option (dehazing parameters estimated for every frame)
+	double Cut = 0.5;									// Default option (scene cut detection on)
+	int Scale = 1;										// Default option (temporal average at full resolution)
+	int Chunks = 0;										// Default option (one process)
+	int Start = -1, Count = -1, Warmup = 0;				// Default option (the whole video)
+	double Deadline = 0;								// Default option (full quality)
+	int FrameLog = 0;									// Default option (only the latency percentiles)
 
 	std::string InputFile = cvParser.get<cv::String>(0); // String containing the input file path+name+extension from cvParser function
 	std::string method = cvParser.get<cv::String>("m");	 // Gets argument -m=x, where 'x' is the enhancement method
 	std::string implementation;							 // CPU or GPU implementation
 	Comp = cvParser.get<int>("comp");					 // Gets argument -comp=x, where 'x' defines if the comparison video will be saved or not
 	Time = cvParser.get<int>("time");	                 // Gets argument -time=x, where 'x' defines if execution time will show or not
+	Queue = cvParser.get<int>("queue");					 // Gets argument -queue=x, where 'x' is the depth of the queues between the pipeline stages
+	Threads = cvParser.get<int>("threads");				 // Gets argument -threads=x, where 'x' is the number of worker threads of the C and E methods
+	InFlight = cvParser.get<int>("inflight");			 // Gets argument -inflight=x, where 'x' is the maximum number of frames held by the workers
+	Tau = cvParser.get<double>("tau");					 // Gets argument -tau=x, where 'x' is the time constant of the temporal histograms
+	Dehaze.every = std::max(1, cvParser.get<int>("every"));	// Gets argument -every=x, where 'x' is the maximum number of frames between estimations
+	Dehaze.drift = cvParser.get<double>("drift");		 // Gets argument -drift=x, where 'x' is the change of the average that forces an estimation
+	Dehaze.cache = cvParser.get<int>("cachetrans") != 0; // Gets argument -cachetrans=x, where 'x' defines if the transmittance is reused
+	Cut = cvParser.get<double>("cut");					 // Gets argument -cut=x, where 'x' is the histogram distance of a scene cut
+	Scale = std::max(1, cvParser.get<int>("scale"));	 // Gets argument -scale=x, where 'x' is the downsampling of the temporal statistics
+	Chunks = cvParser.get<int>("chunks");				 // Gets argument -chunks=x, where 'x' is the number of worker processes
+	Start = cvParser.get<int>("start");					 // Gets argument -start=x, where 'x' is the first frame of the chunk
+	Count = cvParser.get<int>("count");					 // Gets argument -count=x, where 'x' is the number of frames of the chunk
+	Warmup = cvParser.get<int>("warmup");				 // Gets argument -warmup=x, where 'x' is the number of frames before the chunk
+	Deadline = cvParser.get<double>("deadline");		 // Gets argument -deadline=x, where 'x' is the time budget of each frame in ms
+	FrameLog = cvParser.get<int>("framelog");			 // Gets argument -framelog=x, where 'x' defines if the timings of every frame are saved
 
 	// Check if any error occurred during parsing process
 	if (!cvParser.check()) {
@@ -85,32 +153,101 @@ int main(int argc, char *argv[]) {
 
 	int nCuda = -1;    //Defines number of detected CUDA devices. By default, -1 acting as error value
 
-	std::size_t filename;
+	cv::Size RawSize;
+	if (Raw && sscanf(cvParser.get<cv::String>("raw").c_str(), "%dx%d", &RawSize.width, &RawSize.height) != 2) {
+		std::cout << "\nThe raw frame size must be given as WxH \n";
+		return -1;
+	}
+
+	std::size_t filename = InputFile.size();
 	if (InputFile.find('.') != std::string::npos) filename = InputFile.find_last_of('.');	// Find the last '.'
 	std::string ext_out = '_' + method + ".avi";
 	std::string OutputFile = InputFile.substr(0, filename);
 	OutputFile.insert(filename, ext_out);
+	if (cvParser.has("out")) OutputFile = cvParser.get<cv::String>("out");	// Output of a chunk
 
 	std::cout << endl << "************************************************************************" << endl;
 	std::cout << endl << "Input: " << InputFile << endl;
 	std::cout << "Output: " << OutputFile << endl;
 
 	// Opend the video file
-	cv::VideoCapture cap(InputFile);
-	if (!cap.isOpened()) {
+	cv::VideoCapture cap;
+	if (!Raw) cap.open(InputFile);
+	if (!Raw && !cap.isOpened()) {
 		std::cout << "\nUnable to open the video \n";
 		return -1;
 	}
 
 	// Get the width/height frame count and the FPS of the video
-	int width = static_cast<int>(cap.get(CAP_PROP_FRAME_WIDTH));
-	int height = static_cast<int>(cap.get(CAP_PROP_FRAME_HEIGHT));
-	int n_frames = int(cap.get(CAP_PROP_FRAME_COUNT));
-	double FPS = cap.get(CAP_PROP_FPS);
+	int width = Raw ? RawSize.width : static_cast<int>(cap.get(CAP_PROP_FRAME_WIDTH));
+	int height = Raw ? RawSize.height : static_cast<int>(cap.get(CAP_PROP_FRAME_HEIGHT));
+	int n_frames = Raw ? INT_MAX : int(cap.get(CAP_PROP_FRAME_COUNT));		// A raw stream has no end known in advance
+	double FPS = Raw ? cvParser.get<double>("fps") : cap.get(CAP_PROP_FPS);
+
+	int n;																// Size of the temporal window in frames
+	if (Raw) n = std::max(1, cvRound(FPS));								// Short window for a live feed, the D method looks ahead half of it
+	else if (n_frames / FPS < 7) n = std::max(1, cvRound(n_frames / FPS * 0.5));
+	else n = cvRound(FPS * 7);
+	int mid = (n - 1) / 2;
+	if (Raw && method[0] == 'D') std::cout << "Temporal window look ahead: " << n - 1 - mid << " frames ("
+		<< 1000.0 * (n - 1 - mid) / FPS << " ms of added latency)" << endl;
+
+	// Saves the execution time next to the output (Showing time results is optional)
+	auto saveTime = [&]() {
+		t = 1000 * ((double)getTickCount() - t) / getTickFrequency();
+		std::cout << endl << "Execution Time" << implementation << ": " << t << " ms " << endl;
+
+		// Name for the output csv file where the time will be saved
+		std::size_t pos;
+		if (OutputFile.find(92) != std::string::npos) pos = OutputFile.find_last_of(92);	// If string contains '\' search for the last one
+		else pos = OutputFile.find_last_of('/');											// If does not contain '\' search for the last '/'
+		std::string Output = OutputFile.substr(0, pos + 1);
+		std::string ext = "execution_time.csv";
+		Output.insert(pos + 1, ext);
+		ofstream file;
+		file.open(Output, std::ios::app);
+		file << endl << OutputFile << ";" << width << ";" << height << ";" << t;
+	};
+
+	// Chunked processing, each worker process enhances a time chunk warming up its temporal state with the previous frames
+	if (Chunks > 1 && Start < 0 && !Raw) {
+		if (Time) t = (double)getTickCount();
+		cap.release();
+		std::string command = shellQuote(argv[0]) + " " + shellQuote(InputFile);
+		for (int k = 1; k < argc; k++) {											// Forwards the options of the enhancement
+			std::string arg = argv[k];
+			if (arg == InputFile || arg.find("-chunks") == 0 || arg.find("-comp") == 0 || arg.find("-time") == 0 || arg.find("-out") == 0) continue;
+			command += " " + shellQuote(arg);
+		}
+		int warmup = (method[0] == 'H' || method[0] == 'D') ? n : 0;				// The C and E methods have no temporal state
+		if (!processChunks(command, InputFile, OutputFile, Chunks, warmup, n_frames, FPS, cv::Size(width, height))) return -1;
+		if (Comp) std::cout << "The comparison video is not saved in chunked processing" << endl;
+		if (Time) saveTime();
+		return 0;
+	}
+
+	// Frames read by a chunk: the warm up, the chunk and the frames after it in the window of its last frame
+	int skip = 0, total = -1;
+	if (Start >= 0) {
+		skip = std::min(Warmup, Start);
+		cap.set(CAP_PROP_POS_FRAMES, Start - skip);
+		if (int(cap.get(CAP_PROP_POS_FRAMES)) != Start - skip) {					// Inaccurate seek, decodes from the beginning instead
+			cap.release();
+			cap.open(InputFile);
+			int grabbed = 0;
+			while (grabbed < Start - skip && cap.grab()) grabbed++;
+			if (grabbed < Start - skip) {
+				std::cout << "\nError! Unable to reach the frame " << Start - skip << " of the video \n";
+				return -1;
+			}
+		}
+		if (Count >= 0) total = skip + Count + (method[0] == 'D' ? n - 1 - mid : 0);
+	}
 
 	// Open a video file for writing the output
-	cv::VideoWriter out(OutputFile,cv::VideoWriter::fourcc('D', 'I', 'V', 'X'), FPS, cv::Size(width, height));
-	if (!out.isOpened()) {
+	cv::VideoWriter out;
+	if (!Raw) out.open(OutputFile,cv::VideoWriter::fourcc('D', 'I', 'V', 'X'), FPS, cv::Size(width, height));
+	if (!Raw && !out.isOpened()) {
 		std::cout << "\nError! Unable to open video file for the output video \n\n" << std::endl;
 		return -1;
 	}
@@ -120,8 +257,10 @@ int main(int argc, char *argv[]) {
 	Comparison.insert(filename, ext_comp);
 
 	// Open a video file for writing the comparison
-	cv::VideoWriter comp(Comparison, cv::VideoWriter::fourcc('D', 'I', 'V', 'X'), FPS, cv::Size(2 * width, height));
-	if (!comp.isOpened()) {
+	cv::VideoWriter comp;
+	if (Raw) Comp = 0;													// Only the enhanced frames are streamed
+	if (Comp) comp.open(Comparison, cv::VideoWriter::fourcc('D', 'I', 'V', 'X'), FPS, cv::Size(2 * width, height));
+	if (Comp && !comp.isOpened()) {
 		std::cout << "\nError! Unable to open video file for the comparison video \n\n" << std::endl;
 		return -1;
 	}
@@ -132,135 +271,143 @@ int main(int argc, char *argv[]) {
 	// CPU Implementation
 	if (! CUDA) {
 
-		cv::Mat image, image_out, comparison, top;
-		vector<cv::Mat> frames;
-		cv::Mat sum(cv::Size(width, height), CV_32FC3, Scalar());
-		cv::Mat avgImg(cv::Size(width, height), CV_32FC3, Scalar());
-		vector<Mat_<uchar>> channels;
+		cv::Mat image_out;
+		cv::Size reduced(std::max(1, width / Scale), std::max(1, height / Scale));	// Resolution of the temporal average
+		runningSum sum(reduced, 3, n);												// Integer sum of the temporal window
+		cv::Mat avgImg(reduced, CV_8UC3, Scalar());
+
+		int i = 0, j = 0, first = 1;
 
-		int i = 0, j = 0;
-		float n;
-		if (n_frames / FPS < 7) n = n_frames / FPS * 0.5;
-		else n = FPS * 7;
+		videoPipeline pipe(cap, out, Comp ? &comp : NULL, Queue, skip, Count, total);	// Decoding and encoding threads
+		if (Raw) pipe.raw(RawSize, Time != 0);
+		videoTelemetry telemetry(FrameLog != 0);							// Latency of every stage
+		pipe.monitor(&telemetry);
+		int got = 0, done = 0;												// Frames of the H method and frames enhanced by the D method
+		sceneCut cuts(method[0] == 'H' || method[0] == 'D' ? Cut : 0);	// Resets the temporal state of the H and D methods
 
 		switch (method[0]) {
 
 			case 'C':	// Color Correction
 				std::cout << endl << "Applying video enhancement using the Gray World Assumption" << endl;
-				for (i = 0; i < n_frames - 1; i++) {
-					cap >> image;
-					image_out = colorcorrection(image);
-					out << image_out;
-					if (Comp) {
-						hconcat(image, image_out, comparison);
-						comp << comparison;
-					}
-				}
+				pipe.process(Threads, InFlight, [](const cv::Mat &frame) { return colorcorrection(frame); });
 				std::cout << "\nProcessed video saved\n";
 				break;
 
 			case 'E':	// Histogram Equalization
 				std::cout << endl << "Applying video enhancement using Histogram Equalization" << endl;
-				for (i = 0; i < n_frames - 1; i++) {
-					cap >> image;
-					split(image, channels);
-					for (j = 0; j < 3; j++) equalizeHist(channels[j], channels[j]);
-					merge(channels, image_out);
-					out << image_out;
-					if (Comp) {
-						hconcat(image, image_out, comparison);
-						comp << comparison;
-					}
-				}
+				pipe.process(Threads, InFlight, [](const cv::Mat &frame) -> cv::Mat {
+					vector<Mat_<uchar>> channels;
+					cv::Mat dst;
+					split(frame, channels);
+					for (int j = 0; j < 3; j++) equalizeHist(channels[j], channels[j]);
+					merge(channels, dst);
+					return dst;
+				});
 				std::cout << "\nProcessed video saved\n";
 			break;
 
-			case 'H':	// Histogram Stretching
+			case 'H': {	// Histogram Stretching
 				std::cout << endl << "Applying video enhancement using Histogram Stretching" << endl;
-				while (true) {
-					if (frames.size() < n) {
-						cap >> image;
-						if (image.empty()) {
-							for (int i = 0; i < (n - 1) / 2; i++) {
-								image_out = ICM(avgImg, frames[(n - 1) / 2 + i], 0.3);
-								out << image_out;
-								if (Comp) {
-									hconcat(frames[(n - 1) / 2 + i], image_out, comparison);
-									comp << comparison;
-								}
-							}
-							std::cout << "\nProcessed video saved\n";
-							break;
-						}
-						frames.push_back(image);
-						image.convertTo(image, CV_32FC3);
-						accumulate(image, sum);
-					}
-					else {
-						sum.convertTo(avgImg, CV_8UC3, 1.0 / n);
-						for (j; j < (n - 1) / 2; j++) {
-							image_out = ICM(avgImg, frames[j], 0.5);
-							out << image_out;
-							if (Comp) {
-								hconcat(frames[j], image_out, comparison);
-								comp << comparison;
-							}
-						}
-						image_out = ICM(avgImg, frames[(n - 1) / 2], 0.5);
-						out << image_out;
-						if (Comp) {
-							hconcat(frames[(n - 1) / 2], image_out, comparison);
-							comp << comparison;
-						}
-						frames.erase(frames.begin());
-						frames[0].convertTo(top, CV_32FC3);
-						subtract(sum, top, sum);
-					}
+				histState state(3, Tau * FPS, Scale);								// Temporal histograms
+				cv::Mat frame;
+				while (pipe.read(frame)) {
+					if (cuts.detect(frame)) state.reset();							// The new scene starts its own histograms
+					int64 t0 = getTickCount();
+					state.update(frame);
+					int64 t1 = getTickCount();
+					image_out = ICM(state, frame, 0.5);
+					telemetry.record(STAGE_STATISTICS, got, 1000.0 * (t1 - t0) / getTickFrequency());
+					telemetry.record(STAGE_ENHANCE, got++, 1000.0 * (getTickCount() - t1) / getTickFrequency());
+					pipe.write(frame, image_out);
 				}
+				std::cout << "\nProcessed video saved\n";
+			}
 			break;
 
-			case 'D':	// Dehazing
+			case 'D': {	// Dehazing
 				std::cout << endl << "Applying video enhancement using the Bright Channel Prior" << endl;
+
+				frameRing frames(n, cv::Size(width, height), CV_8UC3);	// Temporal window
+				frameRing small(Scale > 1 ? n : 0, reduced, CV_8UC3);		// Reduced frames of the running sum
+				std::cout << "Temporal window: " << n << " frames (" << frames.bytes() / (1024 * 1024) << " MB)";
+				if (pipe.buffers() > 0) std::cout << ", exchanging buffers with up to " << pipe.buffers() << " frames of the pipeline ("
+					<< pipe.buffers() * (frames.bytes() / n) / (1024 * 1024) << " MB)";
+				std::cout << endl;
+				std::cout << "Temporal average: " << reduced.width << "x" << reduced.height << " ("
+					<< (small.bytes() + sum.bytes()) / (1024 * 1024) << " MB)" << endl;
+
+				// Adds a frame to the running sum. Its cost and the cost of the other updates of the sum are charged to the next enhanced frame
+				double statistics = 0;
+				auto add = [&](cv::Mat &frame) {
+					int64 t0 = getTickCount();
+					if (Scale > 1) {
+						cv::Mat &reducedFrame = small.next();
+						resize(frame, reducedFrame, reduced, 0, 0, INTER_AREA);
+						small.push();
+						sum.add(reducedFrame);
+					}
+					else sum.add(frame);
+					statistics += 1000.0 * (getTickCount() - t0) / getTickFrequency();
+				};
+
+				// Quality levels of the dehazing logged next to the output
+				deadlineScheduler scheduler(Deadline, 4, OutputFile.substr(0, OutputFile.find_last_of('.')) + "_deadline.csv");
+
+				// Enhances one frame of the window using the temporal average and writes it
+				auto enhance = [&](cv::Mat &frame) {
+					int64 t0 = getTickCount();
+					Dehaze.level = scheduler.level();
+					image_out = dehazing(Dehaze, avgImg, frame);
+					double ms = 1000.0 * (getTickCount() - t0) / getTickFrequency();
+					scheduler.update(ms);
+					telemetry.record(STAGE_STATISTICS, done, statistics);		// One sample of each stage per enhanced frame
+					telemetry.record(STAGE_ENHANCE, done++, ms);
+					statistics = 0;
+					pipe.write(frame, image_out);
+				};
+
+				// Enhances the frames left in the window and empties it
+				auto flush = [&](bool cut) {
+					if ((first || cut) && frames.size() > 0) sum.average(avgImg, frames.size());	// Average of the frames left
+					for (i = first ? 0 : mid; i < frames.size(); i++) enhance(frames[i]);
+					while (frames.size() > 0) frames.pop();
+					while (small.size() > 0) small.pop();
+					sum.reset();
+					first = 1;
+				};
+
 				while (true) {
-					if (frames.size() < n) {
-						cap >> image;
-						if (image.empty()) {
-							for (int i = 0; i < (n - 1) / 2; i++) {
-								image_out = dehazing(avgImg, frames[(n - 1) / 2 + i]);
-								out << image_out;
-								if (Comp) {
-									hconcat(frames[(n - 1) / 2 + i], image_out, comparison);
-									comp << comparison;
-								}
-							}
+					if (!frames.full()) {
+						cv::Mat &slot = frames.next();
+						if (!pipe.read(slot)) {
+							flush(false);
 							std::cout << "\nProcessed video saved\n";
+							std::cout << "Dehazing parameters estimated " << Dehaze.estimations << " times in " << Dehaze.frames << " frames ("
+								<< 100.0 * Dehaze.estimations / std::max(1, Dehaze.frames) << " %)" << endl;
+							scheduler.report();
 							break;
 						}
-						frames.push_back(image);
-						image.convertTo(image, CV_32FC3);
-						accumulate(image, sum);
+						if (cuts.detect(slot)) {										// The new scene starts its own window
+							flush(true);
+							Dehaze.A.clear();											// Forces a new estimation of the dehazing parameters
+						}
+						frames.push();
+						add(slot);
 					}
 					else {
-						sum.convertTo(avgImg, CV_8UC3, 1.0 / n);
-						for (j; j < (n - 1) / 2; j++) {
-							image_out = dehazing(avgImg, frames[j]);
-							out << image_out;
-							if (Comp) {
-								hconcat(frames[j], image_out, comparison);
-								comp << comparison;
-							}
+						int64 t0 = getTickCount();
+						sum.slide(avgImg, Scale > 1 ? small[0] : frames[0], n);	// Average of the window and removal of its oldest frame
+						if (Scale > 1) small.pop();
+						statistics += 1000.0 * (getTickCount() - t0) / getTickFrequency();
+						if (first) {
+							for (j = 0; j < mid; j++) enhance(frames[j]);
+							first = 0;
 						}
-						image_out = dehazing(avgImg, frames[(n - 1) / 2]);
-						out << image_out;
-						if (Comp) {
-							hconcat(frames[(n - 1) / 2], image_out, comparison);
-							comp << comparison;
-						}
-						frames.erase(frames.begin());
-						frames[0].convertTo(top, CV_32FC3);
-						subtract(sum, top, sum);
+						enhance(frames[mid]);
+						frames.pop();											// Removes the oldest frame from the window
 					}
 				}
+			}
 			break;
 
 			default:	// Unrecognized Option
@@ -269,25 +416,16 @@ int main(int argc, char *argv[]) {
 		}
 
 		// When everything done, release the video capture object
+		pipe.report();
+		telemetry.report();
+		cuts.report(pipe.enhancementTime());
+		std::string frameLog = OutputFile.substr(0, OutputFile.find_last_of('.')) + "_frames.csv";
+		if (telemetry.save(frameLog, OutputFile)) std::cout << "Frame timings saved in " << frameLog << endl;
 		cap.release();
 	}
 
 	// End time measurement (Showing time results is optional)
-	if (Time) {
-		t = 1000 * ((double)getTickCount() - t) / getTickFrequency();
-		std::cout << endl << "Execution Time" << implementation << ": " << t << " ms " << endl;
-
-		// Name for the output csv file where the time will be saved
-		std::size_t pos;
-		if (OutputFile.find(92) != std::string::npos) pos = OutputFile.find_last_of(92);	// If string contains '\' search for the last one
-		else pos = OutputFile.find_last_of('/');											// If does not contain '\' search for the last '/'
-		std::string Output = OutputFile.substr(0, pos + 1);
-		std::string ext = "execution_time.csv";
-		Output.insert(pos + 1, ext);
-		ofstream file;
-		file.open(Output, std::ios::app);
-		file << endl << OutputFile << ";" << width << ";" << height << ";" << t;
-	}
+	if (Time) saveTime();
 
 	waitKey(0);
 	return 0;
@@ -28,17 +28,25 @@ cv::Mat histStretch(cv::Mat prev, cv::Mat src, float percent, int direction) {
 
 	cv::Mat histogram;
 	getHistogram(&sum, &histogram);
-	float percent_sum = 0.0, channel_min = -1.0, channel_max = -1.0;
-	float percent_min = percent / 100.0, percent_max = 1.0 - percent_min;
+	float channel_min, channel_max;
+	histLimits(histogram, src.total(), percent, channel_min, channel_max);
+	return stretch(src, channel_min, channel_max, direction);
+}
+
+void histLimits(cv::Mat histogram, double total, float percent, float &channel_min, float &channel_max) {
+	float percent_sum = 0.0, percent_min = percent / 100.0, percent_max = 1.0 - percent_min;
 	int i = 0;
-	
-	while (percent_sum < percent_max * src.total()) {
-		if (percent_sum < percent_min * src.total()) channel_min++;
+	channel_min = -1.0, channel_max = -1.0;
+
+	while (percent_sum < percent_max * total && i < histogram.rows) {
+		if (percent_sum < percent_min * total) channel_min++;
 		percent_sum += histogram.at<float>(i, 0);
 		channel_max++;
 		i++;
 	}
-	
+}
+
+cv::Mat stretch(cv::Mat src, float channel_min, float channel_max, int direction) {
 	cv::Mat dst;
 	if (direction == 0) dst = (src - channel_min) * (255.0 - channel_min) / (channel_max - channel_min) + channel_min;	// Stretches the channel towards the Upper side
 	else if (direction == 2) dst = (src - channel_min) * channel_max / (channel_max - channel_min);						// Stretches the channel towards the Lower side
@@ -47,6 +55,36 @@ cv::Mat histStretch(cv::Mat prev, cv::Mat src, float percent, int direction) {
 	return dst;
 }
 
+histState::histState(int channels, double frames, int scale) : hist(channels, 256, CV_32F, Scalar(0)), scale(std::max(1, scale)), seeded(false) {
+	alpha = frames > 1 ? 1.0 - exp(-1.0 / frames) : 1.0;
+}
+
+void histState::update(const cv::Mat &frame) {
+	cv::Mat src = frame;
+	if (scale > 1) resize(frame, src, Size(std::max(1, frame.cols / scale), std::max(1, frame.rows / scale)), 0, 0, INTER_NEAREST);	// Strided sample
+	int histSize = 256;
+	float range[] = { 0, 256 };
+	const float* histRange = { range };
+	for (int c = 0; c < hist.rows; c++) {
+		cv::Mat h;
+		calcHist(&src, 1, &c, Mat(), h, 1, &histSize, &histRange, true, false);
+		h = h.reshape(1, 1) / (double)src.total();									// Normalized so the weight does not depend on the size
+		cv::Mat row = hist.row(c);
+		if (seeded) addWeighted(row, 1.0 - alpha, h, alpha, 0, row);				// O(256) temporal update
+		else h.copyTo(row);
+	}
+	seeded = true;
+}
+
+void histState::limits(int channel, float percent, float &channel_min, float &channel_max) const {
+	histLimits(hist.row(channel).t(), 1.0, percent, channel_min, channel_max);
+}
+
+void histState::reset() {
+	hist.setTo(Scalar(0));
+	seeded = false;
+}
+
 cv::Mat ICM(cv::Mat prev, cv::Mat src, float percent) {												// Integrated Color Model
 	vector<Mat_<uchar>> chann, channel;
 	split(prev, chann);
@@ -63,6 +101,30 @@ cv::Mat ICM(cv::Mat prev, cv::Mat src, float percent) {												// Integrated
 	return dst;
 }
 
+cv::Mat ICM(histState &state, cv::Mat src, float percent) {								// Integrated Color Model with temporal histograms
+	vector<Mat_<uchar>> channel;
+	split(src, channel);
+	Mat chan[3], result;
+	float channel_min, channel_max;
+	for (int i = 0; i < 3; i++) {
+		state.limits(i, percent, channel_min, channel_max);
+		chan[i] = stretch(channel[i], channel_min, channel_max, 1);				// Histogram stretching of each color channel
+	}
+	merge(chan, 3, result);
+	Mat HSV, hsv[3], dst;
+	cvtColor(result, HSV, COLOR_BGR2HSV);												// Conversion to the HSV color model
+	split(HSV, hsv);
+	for (int i = 1; i < 3; i++) {														// Histogram stretching of the Saturation and Value Channels
+		cv::Mat histogram;
+		getHistogram(&hsv[i], &histogram);
+		histLimits(histogram, hsv[i].total(), percent, channel_min, channel_max);
+		hsv[i] = stretch(hsv[i], channel_min, channel_max, 1);
+	}
+	merge(hsv, 3, HSV);
+	cvtColor(HSV, dst, COLOR_HSV2BGR);													// Conversion to the BGR color model
+	return dst;
+}
+
 cv::Mat colorcorrection(cv::Mat src) {														// Corrects the color
 	cv::Mat LAB, lab[3], dst;
 	cvtColor(src, LAB, COLOR_BGR2Lab);														// Conversion to the CIELAB color space
@@ -113,6 +175,76 @@ cv::Mat dehazing(cv::Mat prev, cv::Mat src) {											// Dehazed an underwater
 	return dst;
 }
 
+cv::Mat dehazing(dehazeState &state, cv::Mat prev, cv::Mat src) {						// Dehazes with the cached parameters
+	cv::Mat thumb;
+	int width = std::min(64, prev.cols);
+	resize(prev, thumb, Size(width, std::max(1, width * prev.rows / prev.cols)), 0, 0, INTER_AREA);	// Reference to measure the drift
+	bool estimate = state.A.empty() || state.age >= state.every;
+	if (!estimate && state.drift > 0) estimate = norm(thumb, state.thumb, NORM_L1) / (255.0 * thumb.total() * thumb.channels()) > state.drift;
+
+	if (state.level >= 3 && !state.trans.empty() && !state.A.empty()) estimate = false;	// Lowest quality, only the radiance recovery
+
+	cv::Mat trans;
+	if (estimate || (!state.cache && state.level < 3)) {
+		int factor = state.level >= 2 ? 4 : state.level == 1 ? 2 : 1;					// Lower quality levels estimate at a lower resolution
+		cv::Mat sum, average = prev, reduced = src;
+		Size size(std::max(1, prev.cols / factor), std::max(1, prev.rows / factor));
+		if (factor > 1) resize(prev, average, size, 0, 0, INTER_AREA);
+		if (size != src.size()) resize(src, reduced, size, 0, 0, INTER_AREA);			// The average can be kept at a lower resolution
+		addWeighted(average, 0.7, reduced, 0.3, 0, sum);
+		trans = dehazingParameters(sum, state, estimate, std::max(4, 30 * average.cols / src.cols));	// Radius of the total reduction
+		if (trans.size() != src.size()) resize(trans, trans, src.size(), 0, 0, INTER_LINEAR);
+		state.trans = trans;
+	}
+	if (estimate) {
+		state.thumb = thumb;
+		state.age = 0;
+		state.estimations++;
+	}
+	if (trans.empty()) trans = state.trans;
+	state.age++;
+	state.frames++;
+
+	vector<Mat_<uchar>> src_chan;
+	vector<Mat_<float>> chan_dehazed;
+	split(src, src_chan);
+	chan_dehazed.push_back(255 - src_chan[0]);											// Compute the new channels for the dehazing process
+	chan_dehazed.push_back(255 - src_chan[1]);
+	chan_dehazed.push_back(src_chan[2]);
+	return dehaze(chan_dehazed, state.A, trans);										// Dehaze the image channels
+}
+
+cv::Mat dehazingParameters(cv::Mat sum, dehazeState &state, bool light, int radius) {
+	vector<Mat_<uchar>> sum_chan, new_chan;
+	split(sum, sum_chan);
+	new_chan.push_back(255 - sum_chan[0]);												// Compute the new channels for the dehazing process
+	new_chan.push_back(255 - sum_chan[1]);
+	new_chan.push_back(sum_chan[2]);
+
+	int size = sqrt(sum.total()) / 40;													// Making the size bigger creates halos around objects
+	cv::Mat bright_chan = brightChannel(new_chan, size);								// Compute the bright channel image
+	cv::Mat mcd = maxColDiff(sum_chan);													// Compute the maximum color difference
+
+	cv::Mat sum_gray;
+	cv::cvtColor(sum, sum_gray, COLOR_BGR2GRAY);
+	if (light) {
+		cv::Mat sum_HSV, S;
+		cv::cvtColor(sum, sum_HSV, COLOR_BGR2HSV);
+		extractChannel(sum_HSV, S, 1);
+		minMaxLoc(S, NULL, &state.lambda);												// Maximum value of the Saturation channel
+		state.lambda = state.lambda / 255.0;
+		state.A = lightEstimation(sum_gray, size, bright_chan, new_chan);				// Estimate the atmospheric light
+	}
+
+	cv::Mat rectified;
+	addWeighted(bright_chan, state.lambda, mcd, 1.0 - state.lambda, 0.0, rectified);	// Rectify the bright channel image
+	cv::Mat trans = transmittance(rectified, state.A);									// Compute the transmittance image
+
+	cv::Mat filtered;
+	guidedFilter(sum_gray, trans, filtered, radius, 0.001, -1);							// Refine the transmittance image
+	return filtered;
+}
+
 cv::Mat brightChannel(std::vector<cv::Mat_<uchar>> channels, int size) {				// Generates the Bright Channel Image
 	cv::Mat maxRGB = max(max(channels[0], channels[1]), channels[2]);					// Maximum Color Image
 	cv::Mat element, bright_chan;
@@ -191,3 +323,612 @@ cv::Mat dehaze(vector<Mat_<float>> channels, vector<uchar> A, cv::Mat trans) {	/
 	dehazed.convertTo(dst, CV_8U);
 	return dst;
 }
+
+frameRing::frameRing(int capacity, cv::Size size, int type) : slots(capacity), head(0), count(0) {
+	for (int i = 0; i < capacity; i++) slots[i].create(size, type);					// Preallocates every slot of the window
+}
+
+cv::Mat &frameRing::next() {
+	return slots[(head + count) % slots.size()];
+}
+
+void frameRing::push() {
+	if (count < (int)slots.size()) count++;
+}
+
+void frameRing::pop() {
+	if (count == 0) return;
+	head = (head + 1) % slots.size();
+	count--;
+}
+
+cv::Mat &frameRing::operator[](int i) {
+	return slots[(head + i) % slots.size()];
+}
+
+size_t frameRing::bytes() const {
+	size_t total = 0;
+	for (size_t i = 0; i < slots.size(); i++) total += slots[i].total() * slots[i].elemSize();
+	return total;
+}
+
+template <typename T>
+class sumRows : public ParallelLoopBody {												// Updates a range of rows of the running sum
+public:
+	sumRows(cv::Mat &sum, const cv::Mat *in, const cv::Mat *out, cv::Mat *avg, const uchar *lut)
+		: sum(sum), in(in), out(out), avg(avg), lut(lut) {}
+
+	void operator()(const Range &range) const {
+		int width = sum.cols * sum.channels();
+		for (int y = range.start; y < range.end; y++) {
+			T *s = sum.ptr<T>(y);
+			if (in) {
+				const uchar *a = in->ptr<uchar>(y);
+				for (int x = 0; x < width; x++) s[x] += a[x];
+			}
+			if (avg) {
+				uchar *d = avg->ptr<uchar>(y);
+				for (int x = 0; x < width; x++) d[x] = lut[s[x]];
+			}
+			if (out) {
+				const uchar *r = out->ptr<uchar>(y);
+				for (int x = 0; x < width; x++) s[x] -= r[x];
+			}
+		}
+	}
+
+private:
+	cv::Mat &sum;
+	const cv::Mat *in, *out;
+	cv::Mat *avg;
+	const uchar *lut;
+};
+
+runningSum::runningSum(cv::Size size, int channels, int capacity) : capacity(std::max(1, capacity)), frames(0) {
+	int depth = 255 * this->capacity <= USHRT_MAX ? CV_16U : CV_32S;				// 16 bit lanes up to 257 frames
+	sum.create(size, CV_MAKETYPE(depth, channels));
+	sum.setTo(Scalar::all(0));
+	lut.resize(255 * this->capacity + 1);
+}
+
+void runningSum::divisor(int n) {
+	if (n == frames || n < 1) return;
+	frames = n;
+	for (size_t s = 0; s < lut.size(); s++) lut[s] = (uchar)std::min<size_t>(255, (s + n / 2) / n);	// Rounded quotient
+}
+
+void runningSum::apply(const cv::Mat *in, const cv::Mat *out, cv::Mat *avg) {
+	if (avg) avg->create(sum.size(), CV_MAKETYPE(CV_8U, sum.channels()));
+	if (sum.depth() == CV_16U) parallel_for_(Range(0, sum.rows), sumRows<ushort>(sum, in, out, avg, &lut[0]));
+	else parallel_for_(Range(0, sum.rows), sumRows<int>(sum, in, out, avg, &lut[0]));
+}
+
+void runningSum::add(const cv::Mat &frame) {
+	CV_Assert(frame.size() == sum.size() && frame.type() == CV_MAKETYPE(CV_8U, sum.channels()));
+	apply(&frame, NULL, NULL);
+}
+
+void runningSum::average(cv::Mat &dst, int n) {
+	divisor(n);
+	apply(NULL, NULL, &dst);
+}
+
+void runningSum::slide(cv::Mat &dst, const cv::Mat &oldest, int n) {
+	CV_Assert(oldest.size() == sum.size() && oldest.type() == CV_MAKETYPE(CV_8U, sum.channels()));
+	divisor(n);
+	apply(NULL, &oldest, &dst);
+}
+
+void runningSum::reset() {
+	sum.setTo(Scalar::all(0));
+}
+
+videoPipeline::videoPipeline(cv::VideoCapture &cap, cv::VideoWriter &out, cv::VideoWriter *comp, int depth, int skip, int keep, int total) :
+	cap(cap), out(out), comp(comp), threaded(depth > 0), finished(false), decoded(depth), recycled(depth + 2), encoded(depth),
+	compared(depth), decodeTime(0), encodeTime(0), waitTime(0), compareTime(0), count(0), skip(skip), keep(keep), total(total), decodedFrames(0), encodedFrames(0),
+	workers(0), limit(0), taken(0), written(0), workTime(0), started(false), logLatency(false), telemetry(NULL) {
+	start = getTickCount();
+}
+
+void videoPipeline::raw(cv::Size size, bool log) {
+	rawSize = size;
+	logLatency = log;
+}
+
+void videoPipeline::monitor(videoTelemetry *t) {
+	telemetry = t;
+}
+
+void videoPipeline::begin() {									// Starts the stages with the first frame
+	if (started) return;
+	started = true;
+	start = getTickCount();
+	if (threaded) {
+		decoder = std::thread(&videoPipeline::decode, this);
+		encoder = std::thread(&videoPipeline::encode, this);
+		if (comp) comparer = std::thread(&videoPipeline::compare, this);
+	}
+}
+
+bool videoPipeline::grab(cv::Mat &frame) {
+	if (rawSize.area() == 0) cap >> frame;
+	else {
+		frame.create(rawSize, CV_8UC3);							// Raw BGR24 frame from the standard input
+		size_t bytes = frame.total() * frame.elemSize();
+		if (fread(frame.data, 1, bytes, stdin) != bytes) frame.release();
+	}
+	if (frame.empty()) return false;
+	std::lock_guard<std::mutex> lock(stampLock);
+	stamps.push_back(getTickCount());
+	return true;
+}
+
+videoPipeline::~videoPipeline() {
+	finish();
+}
+
+void videoPipeline::decode() {									// Decoder stage
+	cv::Mat frame;
+	while (total < 0 || decodedFrames < total) {
+		frame = cv::Mat();
+		if (recycled.tryPop(frame) && frame.u && frame.u->refcount > 1) frame = cv::Mat();	// Reuses only buffers nobody else holds
+		int64 t0 = getTickCount();
+		bool ok = grab(frame);
+		int64 t1 = getTickCount();
+		decodeTime += t1 - t0;
+		if (ok && telemetry) telemetry->record(STAGE_DECODE, decodedFrames, 1000.0 * (t1 - t0) / getTickFrequency());
+		if (!ok || !decoded.push(frame)) break;
+		decodedFrames++;
+	}
+	decoded.close();
+}
+
+void videoPipeline::encode() {									// Encoder stage
+	std::pair<cv::Mat, cv::Mat> item;
+	while (encoded.pop(item)) {
+		int64 t0 = getTickCount();
+		bool kept = output(item.first, item.second);
+		encodeTime += getTickCount() - t0;
+		if (comp && kept) compared.push(item);					// The comparison is encoded in its own thread
+		else recycled.tryPush(item.first);						// Reused by the decoder once no other stage holds it
+		item = std::pair<cv::Mat, cv::Mat>();
+	}
+	compared.close();
+}
+
+int videoPipeline::buffers() const {
+	if (!threaded) return 0;
+	return (int)(decoded.capacity() + recycled.capacity() + encoded.capacity() + (comp ? compared.capacity() : 0));
+}
+
+bool videoPipeline::read(cv::Mat &frame) {
+	begin();
+	int64 t0 = getTickCount();
+	bool ok;
+	if (threaded) {
+		cv::Mat next;
+		ok = decoded.pop(next);
+		if (ok) {
+			std::swap(frame, next);
+			if (!next.empty()) recycled.tryPush(next);			// The previous buffer of the frame goes back to the decoder
+		}
+	}
+	else {
+		ok = (total < 0 || decodedFrames < total) && grab(frame);
+		int64 t1 = getTickCount();
+		if (ok && telemetry) telemetry->record(STAGE_DECODE, decodedFrames, 1000.0 * (t1 - t0) / getTickFrequency());
+		if (ok) decodedFrames++;
+		decodeTime += t1 - t0;
+	}
+	waitTime += getTickCount() - t0;
+	if (ok) count++;
+	return ok;
+}
+
+void videoPipeline::write(const cv::Mat &src, const cv::Mat &dst) {
+	int64 t0 = getTickCount();
+	if (threaded) encoded.push(std::make_pair(src, dst));
+	else {
+		bool kept = output(src, dst);
+		int64 t1 = getTickCount();
+		encodeTime += t1 - t0;
+		if (comp && kept) {
+			composite(src, dst);
+			compareTime += getTickCount() - t1;
+		}
+	}
+	waitTime += getTickCount() - t0;
+}
+
+bool videoPipeline::output(const cv::Mat &src, const cv::Mat &dst) {
+	int index = encodedFrames++;
+	int64 stamp = -1;
+	{
+		std::lock_guard<std::mutex> lock(stampLock);
+		if (!stamps.empty()) {
+			stamp = stamps.front();
+			stamps.pop_front();
+		}
+	}
+	if (index < skip || (keep >= 0 && index >= skip + keep)) return false;		// Warm up and look ahead frames of a chunk
+	int64 t0 = getTickCount();
+	if (rawSize.area() > 0) {
+		cv::Mat frame = dst.isContinuous() ? dst : dst.clone();
+		fwrite(frame.data, 1, frame.total() * frame.elemSize(), stdout);		// Raw BGR24 frame to the standard output
+		fflush(stdout);
+	}
+	else out << dst;
+	if (telemetry) telemetry->record(STAGE_ENCODE, index, 1000.0 * (getTickCount() - t0) / getTickFrequency());
+	if (stamp < 0) return true;											// The frame was not read by the pipeline
+	double latency = 1000 * (getTickCount() - stamp) / getTickFrequency();	// From the frame read to the frame written
+	latencies.push_back(latency);
+	if (logLatency) std::cerr << "Frame " << index << " latency: " << latency << " ms" << endl;
+	return true;
+}
+
+void videoPipeline::composite(const cv::Mat &src, const cv::Mat &dst) {
+	canvas.create(src.rows, src.cols + dst.cols, src.type());					// Allocated only for the first frame
+	src.copyTo(canvas(Rect(0, 0, src.cols, src.rows)));
+	dst.copyTo(canvas(Rect(src.cols, 0, dst.cols, dst.rows)));
+	*comp << canvas;
+}
+
+void videoPipeline::compare() {									// Comparison encoder stage
+	std::pair<cv::Mat, cv::Mat> item;
+	while (compared.pop(item)) {
+		int64 t0 = getTickCount();
+		composite(item.first, item.second);
+		compareTime += getTickCount() - t0;
+		recycled.tryPush(item.first);
+		item = std::pair<cv::Mat, cv::Mat>();
+	}
+}
+
+void videoPipeline::process(int n, int inflight, std::function<cv::Mat(const cv::Mat &)> enhance) {
+	begin();
+	if (!threaded || n < 2) {										// Sequential enhancement
+		cv::Mat frame;
+		for (int index = 0; read(frame); index++) {
+			int64 t0 = getTickCount();
+			cv::Mat result = enhance(frame);
+			if (telemetry) telemetry->record(STAGE_ENHANCE, index, 1000.0 * (getTickCount() - t0) / getTickFrequency());
+			write(frame, result);
+		}
+		return;
+	}
+	workers = n;
+	limit = inflight > 0 ? std::max(inflight, n) : 2 * n;			// Frames being enhanced or waiting in the reorder buffer
+	int threads = getNumThreads();
+	setNumThreads(1);												// The frames already use every core
+	vector<std::thread> pool;
+	for (int i = 0; i < n; i++) pool.push_back(std::thread(&videoPipeline::work, this, std::ref(enhance)));
+	for (int i = 0; i < n; i++) pool[i].join();
+	setNumThreads(threads);
+}
+
+void videoPipeline::work(std::function<cv::Mat(const cv::Mat &)> &enhance) {	// Worker stage
+	while (true) {
+		cv::Mat frame;
+		int index;
+		{
+			std::unique_lock<std::mutex> take(takeLock);
+			{
+				std::unique_lock<std::mutex> lock(orderLock);
+				released.wait(lock, [this] { return taken - written < limit; });	// In flight limit
+			}
+			if (!decoded.pop(frame)) break;
+			index = taken++;
+		}
+		int64 t0 = getTickCount();
+		cv::Mat result = enhance(frame);
+		int64 t1 = getTickCount();
+		if (telemetry) telemetry->record(STAGE_ENHANCE, index, 1000.0 * (t1 - t0) / getTickFrequency());
+
+		std::lock_guard<std::mutex> lock(orderLock);
+		pending[index] = std::make_pair(frame, result);
+		while (!pending.empty() && pending.begin()->first == written) {	// Passes the consecutive frames to the encoder
+			encoded.push(pending.begin()->second);
+			pending.erase(pending.begin());
+			written++;
+		}
+		workTime += t1 - t0;
+		count++;
+		released.notify_all();
+	}
+}
+
+void videoPipeline::finish() {
+	if (finished) return;
+	finished = true;
+	if (threaded) {
+		decoded.close();										// Stops the decoder if the enhancement ended before the video
+		encoded.close();
+		if (decoder.joinable()) decoder.join();
+		if (encoder.joinable()) encoder.join();
+		if (comparer.joinable()) comparer.join();
+	}
+	end = getTickCount();
+}
+
+double videoPipeline::enhancementTime() {
+	finish();
+	if (workers > 0) return workTime / getTickFrequency();
+	return (end - start - waitTime) / getTickFrequency();
+}
+
+void videoPipeline::report() {
+	finish();
+	double elapsed = double(std::max<int64>(1, end - start));
+	double busy[4] = { decodeTime / elapsed, (elapsed - waitTime) / elapsed, encodeTime / elapsed, compareTime / elapsed };
+	if (workers > 0) busy[1] = workTime / (workers * elapsed);	// Average of the worker threads
+	const char *stages[4] = { "Decoding", "Enhancement", "Encoding", "Comparison encoding" };
+	int n = comp ? 4 : 3;
+	int slowest = 0;
+	std::streamsize precision = std::cout.precision(1);
+	std::cout << endl << "Pipeline: " << count << " frames, " << fixed << count * getTickFrequency() / elapsed << " fps";
+	if (workers > 0) std::cout << ", " << workers << " workers (" << limit << " frames in flight)";
+	std::cout << endl;
+	for (int i = 0; i < n; i++) {
+		std::cout << "\t" << stages[i] << " utilization: " << 100 * busy[i] << " %" << endl;
+		if (busy[i] > busy[slowest]) slowest = i;
+	}
+	std::cout << "\tLimiting stage: " << stages[slowest] << endl;
+	if (!latencies.empty()) {
+		double sum = 0, worst = 0;
+		for (size_t i = 0; i < latencies.size(); i++) {
+			sum += latencies[i];
+			worst = std::max(worst, latencies[i]);
+		}
+		std::cout << "\tLatency: " << sum / latencies.size() << " ms mean, " << worst << " ms max" << endl;
+	}
+	std::cout.unsetf(std::ios::fixed);
+	std::cout.precision(precision);
+}
+
+sceneCut::sceneCut(double threshold) : threshold(threshold), frames(0), cuts(0), time(0) {}
+
+bool sceneCut::detect(const cv::Mat &frame) {
+	if (threshold <= 0) return false;
+	int64 t0 = getTickCount();
+	int width = std::min(64, frame.cols);
+	resize(frame, thumb, Size(width, std::max(1, width * frame.rows / frame.cols)), 0, 0, INTER_NEAREST);	// Reads only the sampled pixels
+	int channels[] = { 0, 1, 2 };
+	int histSize[] = { 4, 4, 4 };
+	float range[] = { 0, 256 };
+	const float *ranges[] = { range, range, range };
+	calcHist(&thumb, 1, channels, Mat(), hist, 3, histSize, ranges, true, false);	// Joint histogram of 64 colors
+	bool cut = !prevHist.empty() && compareHist(hist, prevHist, HISTCMP_BHATTACHARYYA) > threshold;
+	std::swap(hist, prevHist);
+	frames++;
+	if (cut) cuts++;
+	time += getTickCount() - t0;
+	return cut;
+}
+
+void sceneCut::report(double enhancement) {
+	if (threshold <= 0 || frames == 0) return;
+	double seconds = time / getTickFrequency();
+	std::cout << "Scene cuts: " << cuts << ", detection " << 1000 * seconds / frames << " ms per frame ("
+		<< 100 * seconds / std::max(enhancement, 1e-9) << " % of the enhancement time)" << endl;
+}
+
+bool processChunks(std::string command, std::string input, std::string output, int workers, int warmup, int n_frames, double FPS, cv::Size size) {
+	std::size_t dot = output.find_last_of('.');
+	vector<std::string> parts(workers);
+	vector<double> seconds(workers, 0);
+	vector<int> status(workers, 0);
+	vector<std::thread> pool;
+
+	std::cout << endl << "Enhancing " << n_frames << " frames in " << workers << " chunks (warm up of " << warmup << " frames)" << endl;
+	int64 t0 = getTickCount();
+	for (int k = 0; k < workers; k++) {
+		int start = (int)((int64)n_frames * k / workers);
+		int count = k == workers - 1 ? -1 : (int)((int64)n_frames * (k + 1) / workers) - start;	// The last chunk reads until the end
+		parts[k] = output.substr(0, dot) + "_part" + std::to_string(k) + ".avi";
+		std::string chunk = command + " -chunks=0 -start=" + std::to_string(start) + " -count=" + std::to_string(count) +
+			" -warmup=" + std::to_string(warmup) + " " + shellQuote("-out=" + parts[k]) + " > " + shellQuote(parts[k] + ".log") + " 2>&1";
+		pool.push_back(std::thread([&, k, chunk] {
+			int64 c0 = getTickCount();
+			status[k] = std::system(chunk.c_str());
+			seconds[k] = (getTickCount() - c0) / getTickFrequency();
+		}));
+	}
+	for (int k = 0; k < workers; k++) pool[k].join();
+	double wall = (getTickCount() - t0) / getTickFrequency();
+
+	double busy = 0, slowest = 0;
+	for (int k = 0; k < workers; k++) {
+		if (status[k] != 0) {
+			std::cout << "Error! Chunk " << k << " failed, see " << parts[k] << ".log" << endl;
+			return false;
+		}
+		busy += seconds[k];
+		slowest = std::max(slowest, seconds[k]);
+		std::remove((parts[k] + ".log").c_str());
+	}
+
+	int64 t1 = getTickCount();
+	if (!concatVideos(parts, output, FPS, size)) {
+		std::cout << "Error! Unable to join the chunks in " << output << endl;
+		return false;
+	}
+	double join = (getTickCount() - t1) / getTickFrequency();
+	for (int k = 0; k < workers; k++) std::remove(parts[k].c_str());
+
+	cv::VideoCapture check(output);
+	int frames = int(check.get(CAP_PROP_FRAME_COUNT));
+	std::cout << "Output frames: " << frames << " of " << n_frames << endl;
+	if (frames != n_frames) {
+		std::cout << "Error! The frame count of " << output << " does not match the input" << endl;
+		return false;
+	}
+
+	// The chunks run concurrently, so their times only show how evenly the work is spread, not the gain over one process
+	std::cout << "Chunks: " << wall << " s with " << workers << " workers, " << busy << " s in the chunks (slowest " << slowest
+		<< " s), joined in " << join << " s" << endl;
+	std::cout << "Load balance: " << 100 * busy / (workers * std::max(slowest, 1e-9)) << " %, warm up overhead: "
+		<< 100.0 * warmup * (workers - 1) / std::max(1, n_frames) << " %" << endl;
+	return true;
+}
+
+std::string shellQuote(const std::string &arg) {
+#ifdef _WIN32
+	std::string quoted = "\"";														// cmd.exe and the C runtime parsing
+	int slashes = 0;
+	for (size_t i = 0; i < arg.size(); i++) {
+		if (arg[i] == '\\') slashes++;
+		else {
+			if (arg[i] == '"') quoted.append(slashes + 1, '\\');					// Escapes the backslashes before a quote and the quote
+			slashes = 0;
+		}
+		quoted += arg[i];
+	}
+	quoted.append(slashes, '\\');													// Backslashes before the closing quote
+	return quoted + "\"";
+#else
+	std::string quoted = "'";														// Nothing is expanded between single quotes
+	for (size_t i = 0; i < arg.size(); i++) {
+		if (arg[i] == '\'') quoted += "'\\''";
+		else quoted += arg[i];
+	}
+	return quoted + "'";
+#endif
+}
+
+bool concatVideos(vector<std::string> parts, std::string output, double FPS, cv::Size size) {
+#ifdef _WIN32
+	const char *null = "NUL";
+#else
+	const char *null = "/dev/null";
+#endif
+	std::string list = output + ".txt";
+	ofstream file(list);
+	for (size_t k = 0; k < parts.size(); k++) {
+		std::size_t pos = parts[k].find_last_of("/\\");								// The list is next to the parts
+		file << "file '" << (pos == std::string::npos ? parts[k] : parts[k].substr(pos + 1)) << "'" << endl;
+	}
+	file.close();
+	bool copied = std::system(("ffmpeg -version > " + std::string(null) + " 2>&1").c_str()) == 0 &&
+		std::system(("ffmpeg -y -loglevel error -f concat -safe 0 -i " + shellQuote(list) + " -c copy " + shellQuote(output)).c_str()) == 0;
+	std::remove(list.c_str());
+	if (copied) return true;
+
+	cv::VideoWriter out(output, cv::VideoWriter::fourcc('D', 'I', 'V', 'X'), FPS, size);	// Encodes the frames again
+	if (!out.isOpened()) return false;
+	cv::Mat frame;
+	for (size_t k = 0; k < parts.size(); k++) {
+		cv::VideoCapture cap(parts[k]);
+		if (!cap.isOpened()) return false;
+		while (cap.read(frame)) out << frame;
+	}
+	return true;
+}
+
+deadlineScheduler::deadlineScheduler(double budget, int levels, std::string log) : frames(0), misses(0), budget(budget), average(0),
+	current(0), levels(levels), calm(0), perLevel(levels, 0) {
+	if (budget > 0 && !log.empty()) {
+		file.open(log, std::ios::app);
+		name = log;
+	}
+}
+
+void deadlineScheduler::update(double ms) {
+	if (budget <= 0) return;
+	bool miss = ms > budget;
+	if (file.is_open()) file << endl << name << ";" << frames << ";" << current << ";" << fixed << setprecision(2) << ms << ";" << miss;
+	perLevel[current]++;
+	frames++;
+	if (miss) misses++;
+
+	average = frames == 1 ? ms : 0.7 * average + 0.3 * ms;
+	if (average > 0.9 * budget && current < levels - 1) {						// Close to the budget, lowers the quality
+		current++;
+		average = 0.5 * budget;
+		calm = 0;
+	}
+	else if (average < 0.5 * budget && current > 0) {							// Raises the quality after some frames well within the budget
+		if (++calm >= 30) {
+			current--;
+			calm = 0;
+		}
+	}
+	else calm = 0;
+}
+
+void deadlineScheduler::report() {
+	if (budget <= 0 || frames == 0) return;
+	std::cout << "Deadline of " << budget << " ms: " << misses << " misses in " << frames << " frames (" << 100.0 * misses / frames << " %)" << endl;
+	for (int i = 0; i < levels; i++) std::cout << "\tQuality level " << i << ": " << perLevel[i] << " frames" << endl;
+	if (file.is_open()) std::cout << "Quality levels saved in " << name << endl;
+}
+
+latencyHistogram::latencyHistogram() : buckets(1024, 0), worst(0), total(0) {}
+
+void latencyHistogram::record(double ms) {
+	int64 us = std::max<int64>(0, (int64)(1000 * ms));
+	int index = (int)us;
+	if (us >= 64) {
+		int shift = 0;
+		while ((us >> shift) >= 64) shift++;									// Sub bucket between 32 and 63
+		index = 64 + (shift - 1) * 32 + (int)(us >> shift) - 32;
+	}
+	buckets[std::min(index, (int)buckets.size() - 1)]++;
+	worst = std::max(worst, ms);
+	total++;
+}
+
+double latencyHistogram::percentile(double p) const {
+	int64 rank = (int64)ceil(p / 100.0 * total), seen = 0;
+	for (int i = 0; i < (int)buckets.size(); i++) {
+		seen += buckets[i];
+		if (seen >= rank && seen > 0) {
+			if (i < 64) return i / 1000.0;
+			int shift = (i - 64) / 32 + 1, sub = (i - 64) % 32 + 32;
+			return std::min(worst, (((int64)sub << shift) + ((int64)1 << (shift - 1))) / 1000.0);	// Middle of the bucket
+		}
+	}
+	return worst;
+}
+
+videoTelemetry::videoTelemetry(bool perFrame) : perFrame(perFrame) {
+	for (int i = 0; i < STAGES; i++) worstFrame[i] = -1;
+}
+
+void videoTelemetry::record(int stage, int frame, double ms) {
+	std::lock_guard<std::mutex> guard(lock);
+	if (ms > hist[stage].max()) worstFrame[stage] = frame;
+	hist[stage].record(ms);
+	if (perFrame && frame >= 0) {
+		if (frame >= (int)frames.size()) {
+			std::array<float, STAGES> empty;
+			empty.fill(0);
+			frames.resize(frame + 1, empty);
+		}
+		frames[frame][stage] += (float)ms;
+	}
+}
+
+void videoTelemetry::report() {
+	const char *stages[STAGES] = { "Decoding", "Statistics", "Enhancement", "Encoding" };
+	std::streamsize precision = std::cout.precision(2);
+	std::cout << endl << "Stage latency (ms):  p50 / p95 / p99 / max" << endl << fixed;
+	for (int i = 0; i < STAGES; i++) {
+		if (hist[i].count() == 0) continue;
+		std::cout << "\t" << stages[i] << ": " << hist[i].percentile(50) << " / " << hist[i].percentile(95) << " / "
+			<< hist[i].percentile(99) << " / " << hist[i].max() << " (frame " << worstFrame[i] << ")" << endl;
+	}
+	std::cout.unsetf(std::ios::fixed);
+	std::cout.precision(precision);
+}
+
+bool videoTelemetry::save(std::string file, std::string name) {
+	if (!perFrame) return false;
+	ofstream csv(file, std::ios::app);
+	if (!csv.is_open()) return false;
+	csv << fixed << setprecision(3);
+	for (size_t k = 0; k < frames.size(); k++) {
+		csv << endl << name << ";" << k;
+		for (int i = 0; i < STAGES; i++) csv << ";" << frames[k][i];
+	}
+	return true;
+}